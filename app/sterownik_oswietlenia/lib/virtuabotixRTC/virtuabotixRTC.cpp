@@ -200,6 +200,57 @@
       #define DS1302_IO_PIN     IO                  // Arduino pin for the Data I/O                      //|
       #define DS1302_CE_PIN     C_E                 // Arduino pin for the Chip Enable                   //|
                                                                                                          //|
+//++++++++++++++++++++++++++++++++++++++++++++ Pin Access ++++++++++++++++++++++++++++++++++++++++++++++ //|
+//  The fast path writes the PORT/DDR registers and samples PIN through the pointers resolved in the     //|
+//  constructor: a couple of cycles per edge instead of several microseconds for each digitalWrite,      //|
+//  digitalRead and pinMode.  Each register update is a read-modify-write of the whole port, and the     //|
+//  Timer1 ISR drives the 1-10V output on PORTD (OutputRegulator::tick), so every update runs with       //|
+//  interrupts held off for its few cycles - an ISR write between the read and the write back would      //|
+//  otherwise be undone.                                                                                 //|
+#ifdef DS1302_FAST_IO                                                                                    //|
+  #include <util/delay.h>                                                                                //|
+  #include <util/atomic.h>                                                                               //|
+  static inline void ds1302Set( volatile uint8_t *reg, uint8_t mask )   {                                //|
+    ATOMIC_BLOCK( ATOMIC_RESTORESTATE ) { *reg |= mask; }                                                //|
+  }                                                                                                      //|
+  static inline void ds1302Clear( volatile uint8_t *reg, uint8_t mask ) {                                //|
+    ATOMIC_BLOCK( ATOMIC_RESTORESTATE ) { *reg &= ~mask; }                                               //|
+  }                                                                                                      //|
+  #define DS1302_SCLK_HIGH()     ds1302Set( sclkPort, sclkMask )                                         //|
+  #define DS1302_SCLK_LOW()      ds1302Clear( sclkPort, sclkMask )                                       //|
+  #define DS1302_SCLK_OUTPUT()   ds1302Set( sclkDdr, sclkMask )                                          //|
+  #define DS1302_CE_HIGH()       ds1302Set( cePort, ceMask )                                             //|
+  #define DS1302_CE_LOW()        ds1302Clear( cePort, ceMask )                                           //|
+  #define DS1302_CE_OUTPUT()     ds1302Set( ceDdr, ceMask )                                              //|
+  #define DS1302_IO_WRITE(b)     ( (b) ? ds1302Set( ioPort, ioMask ) : ds1302Clear( ioPort, ioMask ) )   //|
+  #define DS1302_IO_READ()       ( ( *ioPin & ioMask ) != 0 )                                            //|
+  #define DS1302_IO_OUTPUT()     ds1302Set( ioDdr, ioMask )                                              //|
+  #define DS1302_IO_INPUT()      ( ds1302Clear( ioDdr, ioMask ), ds1302Clear( ioPort, ioMask ) )         //|
+  #define DS1302_DELAY_US(us)    _delay_us( us )                             // exact, cycle counted     //|
+#else                                                                                                    //|
+  #define DS1302_SCLK_HIGH()     digitalWrite( DS1302_SCLK_PIN, HIGH )                                   //|
+  #define DS1302_SCLK_LOW()      digitalWrite( DS1302_SCLK_PIN, LOW )                                    //|
+  #define DS1302_SCLK_OUTPUT()   pinMode( DS1302_SCLK_PIN, OUTPUT )                                      //|
+  #define DS1302_CE_HIGH()       digitalWrite( DS1302_CE_PIN, HIGH )                                     //|
+  #define DS1302_CE_LOW()        digitalWrite( DS1302_CE_PIN, LOW )                                      //|
+  #define DS1302_CE_OUTPUT()     pinMode( DS1302_CE_PIN, OUTPUT )                                        //|
+  #define DS1302_IO_WRITE(b)     digitalWrite( DS1302_IO_PIN, b )                                        //|
+  #define DS1302_IO_READ()       digitalRead( DS1302_IO_PIN )                                            //|
+  #define DS1302_IO_OUTPUT()     pinMode( DS1302_IO_PIN, OUTPUT )                                        //|
+  #define DS1302_IO_INPUT()      pinMode( DS1302_IO_PIN, INPUT )                                         //|
+  #define DS1302_DELAY_US(us)    delayMicroseconds( (us) < 1 ? 1 : (unsigned int)(us) )                  //|
+#endif                                                                                                   //|
+                                                                                                         //|
+//+++++++++++++++++++++++++++++++++++++++++++ Bus Timing +++++++++++++++++++++++++++++++++++++++++++++++ //|
+//  Datasheet AC characteristics at VCC = 2.0V, the slowest grade (the module runs from 3.3V).  These    //|
+//  are minimums; interrupts can only stretch them.                                                      //|
+#define DS1302_tCC      4.0                                  // CE to CLK setup, us                      //|
+#define DS1302_tCWH     4.0                                  // CE inactive time, us                     //|
+#define DS1302_tCH      1.0                                  // CLK high time, us                        //|
+#define DS1302_tCL      1.0                                  // CLK low time, us                         //|
+#define DS1302_tDC      0.2                                  // data to CLK setup, us                    //|
+#define DS1302_tCDD     0.8                                  // CLK to data delay, us (tCL covers it)    //|
+                                                                                                         //|
 //++++++++++++++++++++++++++++++++++++++++++ Conversion Macros ++++++++++++++++++++++++++++++++++++++++++//|
 //  Macros to convert the bcd values of the registers to normal integer variables.  The code uses        //|
 //  seperate variables for the high byte and the low byte of the bcd, so these macros handle both bytes  //|
@@ -293,6 +344,18 @@ virtuabotixRTC::virtuabotixRTC(uint8_t inSCLK, uint8_t inIO, uint8_t inC_E)   {
   SCLK = inSCLK;                                                                                         //|    |
   IO = inIO;                                                                                             //|    |
   C_E = inC_E;                                                                                           //|    |
+#ifdef DS1302_FAST_IO                                                                                    //|    |
+  sclkPort = portOutputRegister( digitalPinToPort( inSCLK ) );                                           //|    |
+  sclkDdr  = portModeRegister( digitalPinToPort( inSCLK ) );                                             //|    |
+  sclkMask = digitalPinToBitMask( inSCLK );                                                              //|    |
+  ioPort   = portOutputRegister( digitalPinToPort( inIO ) );                                             //|    |
+  ioDdr    = portModeRegister( digitalPinToPort( inIO ) );                                               //|    |
+  ioPin    = portInputRegister( digitalPinToPort( inIO ) );                                              //|    |
+  ioMask   = digitalPinToBitMask( inIO );                                                                //|    |
+  cePort   = portOutputRegister( digitalPinToPort( inC_E ) );                                            //|    |
+  ceDdr    = portModeRegister( digitalPinToPort( inC_E ) );                                              //|    |
+  ceMask   = digitalPinToBitMask( inC_E );                                                               //|    |
+#endif                                                                                                   //|    |
 }                      //|    |
 //=======================================================================================================//|    |
 //                                                                                                       //|    |
@@ -445,6 +508,67 @@ void virtuabotixRTC::DS1302_clock_burst_write( uint8_t *p)  {
 //                                                                                                              |
 //=======================================================================================================//|    |
 //                                                                                                       //|    |
+//                                  DS1302_ram_burst_read Function Begin                                 //|    |
+//                                                                                                       //|    |
+//=======================================================================================================//|    |
+//                                                                                                       //|    |
+//  This function reads the first 'len' bytes (max 31) of the battery-backed RAM in burst mode.  The     //|    |
+//  burst may be ended after any byte.                                                                   //|    |
+//                                                                                                       //|    |
+//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//|    |
+void virtuabotixRTC::DS1302_ram_burst_read( uint8_t *p, uint8_t len)  {                                  //|    |
+  uint8_t i;                                                                                             //|    |
+  _DS1302_start();                                                                                       //|    |
+                                                                                                         //|    |
+// Instead of the address, the RAM_BURST_READ command is issued the I/O-line is released for the data    //|    |
+  _DS1302_togglewrite( DS1302_RAM_BURST_READ, true);                                                     //|    |
+                                                                                                         //|    |
+  for( i=0; i<len && i<31; i++)  {                                                                       //|    |
+    *p++ = _DS1302_toggleread();                                                                         //|    |
+  }                                                                                                      //|    |
+  _DS1302_stop();                                                                                        //|    |
+}                                                                                                        //|    |
+                                                                                                         //|    |
+//=======================================================================================================//|    |
+//                                                                                                       //|    |
+//                                   DS1302_ram_burst_read Function End                                  //|    |
+//                                                                                                       //|    |
+//=======================================================================================================//|    |
+//                                                                                                              |
+//                                                                                                              |
+//=======================================================================================================//|    |
+//                                                                                                       //|    |
+//                                 DS1302_ram_burst_write Function Begin                                 //|    |
+//                                                                                                       //|    |
+//=======================================================================================================//|    |
+//                                                                                                       //|    |
+//  This function writes the first 'len' bytes (max 31) of the battery-backed RAM in burst mode.  The    //|    |
+//  write protect bit must be cleared by the caller.                                                     //|    |
+//                                                                                                       //|    |
+//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//|    |
+void virtuabotixRTC::DS1302_ram_burst_write( uint8_t *p, uint8_t len)  {                                 //|    |
+  uint8_t i;                                                                                             //|    |
+  _DS1302_start();                                                                                       //|    |
+                                                                                                         //|    |
+// Instead of the address, the RAM_BURST_WRITE command is issued.  The I/O-line is not released          //|    |
+  _DS1302_togglewrite( DS1302_RAM_BURST_WRITE, false);                                                   //|    |
+                                                                                                         //|    |
+  for( i=0; i<len && i<31; i++)  {                                                                       //|    |
+    // the I/O-line is not released                                                                      //|    |
+    _DS1302_togglewrite( *p++, false);                                                                   //|    |
+  }                                                                                                      //|    |
+  _DS1302_stop();                                                                                        //|    |
+}                                                                                                        //|    |
+                                                                                                         //|    |
+//=======================================================================================================//|    |
+//                                                                                                       //|    |
+//                                  DS1302_ram_burst_write Function End                                  //|    |
+//                                                                                                       //|    |
+//=======================================================================================================//|    |
+//                                                                                                              |
+//                                                                                                              |
+//=======================================================================================================//|    |
+//                                                                                                       //|    |
 //                                    DS1302_read Function Begin                                         //|    |
 //                                                                                                       //|    |
 //=======================================================================================================//|    |
@@ -521,16 +645,16 @@ void virtuabotixRTC::DS1302_write( int address, uint8_t data)  {
 //                                                                                                       //|    |
 //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//|    |
 void virtuabotixRTC::_DS1302_start( void )  {                                                            //|    |
-  digitalWrite( DS1302_CE_PIN, LOW );                 // default, not enabled                            //|    |
-  pinMode( DS1302_CE_PIN, OUTPUT );                                                                      //|    |
+  DS1302_CE_LOW();                                    // default, not enabled                            //|    |
+  DS1302_CE_OUTPUT();                                                                                    //|    |
                                                                                                          //|    |
-  digitalWrite( DS1302_SCLK_PIN, LOW );               // default, clock low                              //|    |
-  pinMode( DS1302_SCLK_PIN, OUTPUT );                                                                    //|    |
+  DS1302_SCLK_LOW();                                  // default, clock low                              //|    |
+  DS1302_SCLK_OUTPUT();                                                                                  //|    |
                                                                                                          //|    |
-  pinMode( DS1302_IO_PIN, OUTPUT );                                                                      //|    |
+  DS1302_IO_OUTPUT();                                                                                    //|    |
                                                                                                          //|    |
-  digitalWrite( DS1302_CE_PIN, HIGH );                // start the session                               //|    |
-  delayMicroseconds( 4 );                             // tCC = 4us                                       //|    |
+  DS1302_CE_HIGH();                                   // start the session                               //|    |
+  DS1302_DELAY_US( DS1302_tCC );                                                                         //|    |
 }                                                        //|    |
                                                                                                          //|    |
 //=======================================================================================================//|    |
@@ -551,9 +675,9 @@ void virtuabotixRTC::_DS1302_start( void )  {
 //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//|    |
 void virtuabotixRTC::_DS1302_stop( void )  {                                                             //|    |
   // Set CE low                                                                                          //|    |
-  digitalWrite( DS1302_CE_PIN, LOW );                                                                    //|    |
+  DS1302_CE_LOW();                                                                                       //|    |
                                                                                                          //|    |
-  delayMicroseconds( 4 );                               // tCWH = 4us                                    //|    |
+  DS1302_DELAY_US( DS1302_tCWH );                                                                        //|    |
 }                                                         //|    |
                                                                                                          //|    |
 //=======================================================================================================//|    |
@@ -580,15 +704,17 @@ uint8_t virtuabotixRTC::_DS1302_toggleread( void )  {
 // Issue a clock pulse for the next databit.  If the 'togglewrite' function was used before this         //|    |
 //  function, the SCLK is already high.                                                                  //|    |
   for( i = 0; i <= 7; i++ )  {                                                                           //|    |
-    digitalWrite( DS1302_SCLK_PIN, HIGH );                                                               //|    |
-    delayMicroseconds( 1) ;                                                                              //|    |
+    DS1302_SCLK_HIGH();                                                                                  //|    |
+    DS1302_DELAY_US( DS1302_tCH );                                                                       //|    |
                                                                                                          //|    |
     // Clock down, data is ready after some time.                                                        //|    |
-    digitalWrite( DS1302_SCLK_PIN, LOW );                                                                //|    |
-    delayMicroseconds( 1 );                                  // tCL=1000ns, tCDD=800ns                   //|    |
+    DS1302_SCLK_LOW();                                                                                   //|    |
+    DS1302_DELAY_US( DS1302_tCL );                           // tCL=1000ns, tCDD=800ns                   //|    |
                                                                                                          //|    |
     // read bit, and set it in place in 'data' variable                                                  //|    |
-    bitWrite( data, i, digitalRead( DS1302_IO_PIN ) );                                                   //|    |                                                                                                 //|    |
+    if( DS1302_IO_READ() )  {                                                                            //|    |
+      data |= ( 1 << i );                                                                                //|    |
+    }                                                                                                    //|    |
   }                                                                                                      //|    |
   return( data );                                                                                        //|    |
 }                                                //|    |
@@ -615,21 +741,21 @@ void virtuabotixRTC::_DS1302_togglewrite( uint8_t data, uint8_t release)  {
                                                                                                          //|    |
   for( i = 0; i <= 7; i++ )  {                                                                           //|    |
     // set a bit of the data on the I/O-line                                                             //|    |
-    digitalWrite( DS1302_IO_PIN, bitRead(data, i) );                                                     //|    |
-    delayMicroseconds( 1 );                                     // tDC = 200ns                           //|    |
+    DS1302_IO_WRITE( bitRead(data, i) );                                                                 //|    |
+    DS1302_DELAY_US( DS1302_tDC );                              // tDC = 200ns                           //|    |
                                                                                                          //|    |
     // clock up, data is read by DS1302                                                                  //|    |
-    digitalWrite( DS1302_SCLK_PIN, HIGH );                                                               //|    |
-    delayMicroseconds( 1 );                                     // tCH = 1000ns, tCDH = 800ns            //|    |
+    DS1302_SCLK_HIGH();                                                                                  //|    |
+    DS1302_DELAY_US( DS1302_tCH );                              // tCH = 1000ns, tCDH = 800ns            //|    |
                                                                                                          //|    |
 //  If this write is followed by a read, the I/O-line should be released after the last bit, before the  //|    |
 //  clock line is made low.  This is according the datasheet.  I have seen other programs that don't     //|    |
 //  release the I/O-line at this moment, and that could cause a shortcut spike on the I/O-line.          //|    |
     if( release && i == 7 )  {                                                                           //|    |
-      pinMode( DS1302_IO_PIN, INPUT );                                                                   //|    |
+      DS1302_IO_INPUT();                                                                                 //|    |
     }  else  {                                                                                           //|    |
-      digitalWrite( DS1302_SCLK_PIN, LOW );                                                              //|    |
-      delayMicroseconds( 1 );                                   // tCL=1000ns, tCDD=800ns                //|    |
+      DS1302_SCLK_LOW();                                                                                 //|    |
+      DS1302_DELAY_US( DS1302_tCL );                            // tCL=1000ns, tCDD=800ns                //|    |
     }                                                                                                    //|    |
   }                                                                                                      //|    |
 }                          //|    |
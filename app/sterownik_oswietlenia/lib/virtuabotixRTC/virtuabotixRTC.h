@@ -237,6 +237,12 @@
 #define DS1302_ENABLE            0x8E                                                                    //|
 #define DS1302_TRICKLE           0x90                                                                    //|
                                                                                                          //|
+//  Fast I/O: on AVR the bit-bang drives the port registers directly (see virtuabotixRTC.cpp).  Define   //|
+//  DS1302_SLOW_IO to build the original digitalWrite/digitalRead/pinMode path, e.g. to benchmark it.    //|
+#if defined(__AVR__) && !defined(DS1302_SLOW_IO)                                                         //|
+  #define DS1302_FAST_IO                                                                                 //|
+#endif                                                                                                   //|
+                                                                                                         //|
 //=======================================================================================================//|
 //                                                                                                       //|
 //                                     Defines Required for Library End                                  //|
@@ -265,6 +271,8 @@ class virtuabotixRTC  {
     void initRTC(uint8_t CLK, uint8_t IO, uint8_t ENABLE);     // Sets the pins and enable them          //|
     void DS1302_clock_burst_read( uint8_t *p);                 // Reads clock data, and sets pinmode     //|
     void DS1302_clock_burst_write( uint8_t *p);                // Writes clcok data, and sets pinmode    //|
+    void DS1302_ram_burst_read( uint8_t *p, uint8_t len);    // Reads RAM data (31 bytes max)            //|
+    void DS1302_ram_burst_write( uint8_t *p, uint8_t len);   // Writes RAM data (31 bytes max)           //|
     uint8_t DS1302_read(int address);                          // Reads a byte from DS1302, sets pinmode //|
     void DS1302_write( int address, uint8_t data);             // Writes a byte to DS1302, sets pinmode  //|
     void _DS1302_start( void);                                 // Function to help setup start condition //|
@@ -289,6 +297,13 @@ class virtuabotixRTC  {
     uint8_t dayofmonth;                                                                                  //|
     uint8_t month;                                                                                       //|
     int year;                                                                                            //|
+                                                                                                         //|
+#ifdef DS1302_FAST_IO                                        // Port registers and masks, resolved once  //|
+    volatile uint8_t *sclkPort, *sclkDdr;                    // in the constructor from the pin numbers  //|
+    volatile uint8_t *ioPort, *ioDdr, *ioPin;                                                            //|
+    volatile uint8_t *cePort, *ceDdr;                                                                    //|
+    uint8_t sclkMask, ioMask, ceMask;                                                                    //|
+#endif                                                                                                   //|
 };                                                                                                       //|
                                                                                                          //|
 //=======================================================================================================//|
@@ -0,0 +1,88 @@
+#ifndef ADC_CALIBRATION_H
+#define ADC_CALIBRATION_H
+
+#include <stddef.h>
+#include <EEPROM.h>
+#include "Debug.h"
+#include "Constants.h"
+
+// Feedback ADC -> 1-10V line calibration: the window mean (ADC counts) at 1 V (0%) and at
+// 10 V (100%), both referred to the supply measured at calibration time through the internal
+// bandgap. Covers the divider, the AVcc reference and the line's own offset in one line fit;
+// the bandgap reading lets later supply drift be divided out (see FeedbackAdc). Kept in
+// EEPROM; an unprogrammed or implausible copy falls back to the nominal 5 V / 2:1 divider.
+struct AdcCalibration {
+    float   zeroCounts;    // window mean at 1 V
+    float   fullCounts;    // window mean at 10 V (may extrapolate past 1023)
+    float   bandgapCounts; // bandgap mean the counts are referred to; 0 = none yet
+    uint8_t checksum;
+
+    void setDefaults() {
+        zeroCounts = countsFor(FEEDBACK_ZERO_VOLTS);
+        fullCounts = countsFor(FEEDBACK_ZERO_VOLTS + FEEDBACK_SPAN_VOLTS);
+        bandgapCounts = 0.0f;
+    }
+
+    void load() {
+        EEPROM.get(EEPROM_ADC_CAL_ADDR, *this);
+        if (checksum != computeChecksum() || !plausible()) {
+            DEBUG_PRINTLN("ADC cal: invalid, using defaults");
+            setDefaults();
+        }
+    }
+
+    void save() {
+        checksum = computeChecksum();
+        EEPROM.put(EEPROM_ADC_CAL_ADDR, *this);
+    }
+
+    // Two (window mean, line volts) points, as measured with a meter, extrapolated to 1 V and
+    // 10 V. Points too close together or an implausible result leave the calibration alone.
+    bool fromPoints(float countsA, float voltsA, float countsB, float voltsB) {
+        if (abs(voltsB - voltsA) < ADC_CAL_MIN_SPAN_VOLTS) return false;
+        AdcCalibration fit = *this;
+        float countsPerVolt = (countsB - countsA) / (voltsB - voltsA);
+        fit.zeroCounts = countsA + (FEEDBACK_ZERO_VOLTS - voltsA) * countsPerVolt;
+        fit.fullCounts = countsA + (FEEDBACK_ZERO_VOLTS + FEEDBACK_SPAN_VOLTS - voltsA) * countsPerVolt;
+        if (!fit.plausible()) return false;
+        *this = fit;
+        return true;
+    }
+
+    // Window mean -> feedback %, for counts already referred to bandgapCounts
+    float percentFor(float counts) const {
+        return (counts - zeroCounts) * 100.0f / (fullCounts - zeroCounts);
+    }
+
+    // What a feedback % taken on 'previous' reads as on this calibration - the same window mean
+    // through the new line: new % = scale * old % + shift
+    void rescaleFrom(const AdcCalibration& previous, float& scale, float& shift) const {
+        float span = fullCounts - zeroCounts;
+        scale = (previous.fullCounts - previous.zeroCounts) / span;
+        shift = (previous.zeroCounts - zeroCounts) * 100.0f / span;
+    }
+
+private:
+    // Nominal circuit: ADC full scale = FEEDBACK_FULL_SCALE_VOLTS on the line
+    static float countsFor(float lineVolts) {
+        return lineVolts / FEEDBACK_FULL_SCALE_VOLTS * ANALOG_READ_RESOLUTION;
+    }
+
+    // Within ~30% of the nominal circuit (also rejects NaN)
+    bool plausible() const {
+        bool bandgapOk = bandgapCounts == 0.0f ||
+                         (bandgapCounts >= BANDGAP_MIN_COUNTS && bandgapCounts <= BANDGAP_MAX_COUNTS);
+        return zeroCounts >= 0.0f && zeroCounts <= 300.0f && fullCounts >= 700.0f && fullCounts <= 1350.0f &&
+               bandgapOk;
+    }
+
+    uint8_t computeChecksum() const {
+        const uint8_t* p = (const uint8_t*)this;
+        uint8_t sum = 0xA5;
+        // Up to the checksum, not sizeof - 1: on the native build the struct is padded after it
+        for (uint8_t i = 0; i < offsetof(AdcCalibration, checksum); i++) sum += p[i];
+        return sum;
+    }
+};
+
+#endif // ADC_CALIBRATION_H
@@ -0,0 +1,180 @@
+#ifndef BALLAST_MODEL_H
+#define BALLAST_MODEL_H
+
+#include <EEPROM.h>
+#include "Debug.h"
+#include "Constants.h"
+
+// First-order model of the 1-10V line for each ballast mask: feedback settles at
+// gain * output + offset with time constant tau. Every ballast's control input loads the
+// line differently, so each mask needs its own output for the same feedback level.
+// Gain and offset are refitted from settled samples (exponentially weighted least squares,
+// so the fit follows the tubes as they warm up); tau from the window-to-window response while
+// the feedback is still moving. Each entry carries its own checksum in EEPROM - a corrupt or
+// never-programmed entry only resets that mask.
+struct BallastModel {
+    static const uint8_t MASKS = 7; // masks 1-7; nothing to model with all ballasts off
+
+    struct Entry {
+        float    meanOutput;    // weighted moments of the settled samples, %
+        float    meanFeedback;
+        float    varOutput;
+        float    covariance;
+        float    gain;          // feedback % per output %
+        float    offset;        // feedback % at 0% output
+        uint16_t tauMs;
+        uint8_t  samples;       // settled samples taken, saturating
+        uint8_t  checksum;
+    };
+
+    Entry entries[MASKS];
+
+    void load() {
+        EEPROM.get(EEPROM_BALLAST_MODEL_ADDR, entries);
+        for (uint8_t i = 0; i < MASKS; i++) {
+            Entry& e = entries[i];
+            bool valid = e.checksum == computeChecksum(e) &&
+                         e.gain >= MODEL_MIN_GAIN && e.gain <= MODEL_MAX_GAIN; // also rejects NaN
+            if (!valid) {
+                DEBUG_PRINTF("Model: mask %d invalid, using defaults\n", i + 1);
+                setDefaults(e);
+            }
+        }
+    }
+
+    void save() {
+        for (uint8_t i = 0; i < MASKS; i++) entries[i].checksum = computeChecksum(entries[i]);
+        EEPROM.put(EEPROM_BALLAST_MODEL_ADDR, entries); // only masks used since the last save changed
+    }
+
+    // Enough settled samples that outputFor() beats the mask-agnostic feedforward map
+    bool trained(uint8_t mask) const {
+        return mask >= 1 && mask <= MASKS && entries[mask - 1].samples >= MODEL_MIN_SAMPLES;
+    }
+
+    // Output (0-100%) that settles at 'feedbackPercent' on this mask
+    float outputFor(uint8_t mask, float feedbackPercent) const {
+        const Entry& e = entries[mask - 1];
+        return constrain((feedbackPercent - e.offset) / e.gain, 0.0f, 100.0f);
+    }
+
+    // Feedback (%) the output settles at on this mask
+    float feedbackFor(uint8_t mask, float outputPercent) const {
+        const Entry& e = entries[mask - 1];
+        return e.gain * outputPercent + e.offset;
+    }
+
+    unsigned long tauMs(uint8_t mask) const {
+        return (mask >= 1 && mask <= MASKS) ? entries[mask - 1].tauMs : MODEL_DEFAULT_TAU_MS;
+    }
+
+    // A settled (output, feedback) point. The gain is only refitted once the samples spread
+    // over enough output range; until then the offset alone absorbs the error, which keeps the
+    // model exact around the operating point it has seen.
+    void learn(uint8_t mask, float outputPercent, float feedbackPercent) {
+        Entry& e = entries[mask - 1];
+        if (e.samples == 0) {
+            e.meanOutput = outputPercent;
+            e.meanFeedback = feedbackPercent;
+            e.varOutput = 0.0f;
+            e.covariance = 0.0f;
+        } else {
+            float du = outputPercent - e.meanOutput;
+            float dy = feedbackPercent - e.meanFeedback;
+            e.meanOutput += MODEL_LEARN_RATE * du;
+            e.meanFeedback += MODEL_LEARN_RATE * dy;
+            e.varOutput = (1.0f - MODEL_LEARN_RATE) * (e.varOutput + MODEL_LEARN_RATE * du * du);
+            e.covariance = (1.0f - MODEL_LEARN_RATE) * (e.covariance + MODEL_LEARN_RATE * du * dy);
+        }
+        if (e.varOutput >= MODEL_MIN_OUTPUT_VARIANCE) {
+            e.gain = constrain(e.covariance / e.varOutput, MODEL_MIN_GAIN, MODEL_MAX_GAIN);
+        }
+        e.offset = e.meanFeedback - e.gain * e.meanOutput;
+        if (e.samples < 255) e.samples++;
+    }
+
+    // Three consecutive feedback windows of a first-order response: per window the feedback
+    // closes 1 - exp(-window / tau) of its gap to gain * output + offset. Taken as the change of
+    // that step between two windows, against the change of the gap, so an offset the static
+    // fit has not caught up with yet cancels out (steady ramps carry no information and are
+    // skipped). Window means lag half a window behind the line; tau absorbs that, as the
+    // regulator does.
+    void learnDynamics(uint8_t mask, float outputStep, float prevFeedbackStep, float feedbackStep) {
+        Entry& e = entries[mask - 1];
+        float gapChange = e.gain * outputStep - prevFeedbackStep;
+        if (abs(gapChange) < MODEL_TAU_MIN_GAP) return; // too little movement to tell from noise
+        float remaining = 1.0f - (feedbackStep - prevFeedbackStep) / gapChange;
+        if (remaining <= 0.05f || remaining >= 0.995f) return; // overshoot, stall or disturbance
+        // Averaged as the per-window decay, not as tau: -window / log() stretches the noise of a
+        // small gap change near 1 into taus of seconds, and a plain average of tau drifts up
+        float decay = exp(-ADC_WINDOW_MS / e.tauMs);
+        decay += MODEL_TAU_LEARN_RATE * (remaining - decay);
+        e.tauMs = (uint16_t)(-ADC_WINDOW_MS / log(decay) + 0.5f);
+    }
+
+    // Self-test result: a least-squares line through the settled points of a scripted step
+    // sequence replaces the learned fit, and tau from its step responses (0 = keep the learned
+    // one). A gain out of range (dead or saturated line) leaves the entry alone. Returns the
+    // fitted gain; 'linearity' gets the largest deviation of a point from the line, %.
+    float calibrate(uint8_t mask, const float* outputs, const float* feedbacks, uint8_t count,
+                    float tauMs, float& linearity) {
+        float meanOutput = 0.0f, meanFeedback = 0.0f;
+        for (uint8_t i = 0; i < count; i++) {
+            meanOutput += outputs[i] / count;
+            meanFeedback += feedbacks[i] / count;
+        }
+        float varOutput = 0.0f, covariance = 0.0f;
+        for (uint8_t i = 0; i < count; i++) {
+            float du = outputs[i] - meanOutput;
+            varOutput += du * du / count;
+            covariance += du * (feedbacks[i] - meanFeedback) / count;
+        }
+        float gain = varOutput > 0.0f ? covariance / varOutput : 0.0f;
+        float offset = meanFeedback - gain * meanOutput;
+        linearity = 0.0f;
+        for (uint8_t i = 0; i < count; i++) {
+            linearity = max(linearity, abs(feedbacks[i] - (gain * outputs[i] + offset)));
+        }
+        if (gain < MODEL_MIN_GAIN || gain > MODEL_MAX_GAIN) return gain;
+
+        Entry& e = entries[mask - 1];
+        e.meanOutput = meanOutput;
+        e.meanFeedback = meanFeedback;
+        e.varOutput = varOutput;
+        e.covariance = covariance;
+        e.gain = gain;
+        e.offset = offset;
+        if (tauMs > 0.0f) e.tauMs = (uint16_t)(tauMs + 0.5f);
+        e.samples = max(e.samples, MODEL_MIN_SAMPLES);
+        return gain;
+    }
+
+    // The feedback scale changed (new ADC calibration): new % = scale * old % + shift
+    void rescaleFeedback(float scale, float shift) {
+        for (uint8_t i = 0; i < MASKS; i++) {
+            Entry& e = entries[i];
+            e.meanFeedback = scale * e.meanFeedback + shift;
+            e.covariance *= scale;
+            e.gain = constrain(e.gain * scale, MODEL_MIN_GAIN, MODEL_MAX_GAIN);
+            e.offset = e.meanFeedback - e.gain * e.meanOutput;
+        }
+    }
+
+private:
+    static void setDefaults(Entry& e) {
+        e.meanOutput = e.meanFeedback = e.varOutput = e.covariance = 0.0f;
+        e.gain = 1.0f;
+        e.offset = 0.0f;
+        e.tauMs = MODEL_DEFAULT_TAU_MS;
+        e.samples = 0;
+    }
+
+    static uint8_t computeChecksum(const Entry& e) {
+        const uint8_t* p = (const uint8_t*)&e;
+        uint8_t sum = 0xA5;
+        for (uint8_t i = 0; i < sizeof(Entry) - 1; i++) sum += p[i];
+        return sum;
+    }
+};
+
+#endif // BALLAST_MODEL_H
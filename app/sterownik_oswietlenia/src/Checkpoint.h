@@ -0,0 +1,32 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+
+// Fast-boot checkpoint kept in the DS1302's 31-byte battery-backed RAM.
+// The RAM is lost together with the clock on an RTC power-on reset, so a
+// checkpoint that fails its CRC at boot also means the RTC time is suspect.
+// With the DS3231 it lives in an EEPROM ring instead (EepromScratch).
+const uint8_t CHECKPOINT_MAGIC = 0xA5;
+
+struct Checkpoint {
+    uint8_t  magic;
+    uint32_t utc;              // last known-good UTC time
+    uint8_t  ballastMask;
+    int16_t  rotationDay;
+    uint8_t  crc;              // CRC-8 (Dallas/Maxim) over all bytes above
+} __attribute__((packed));
+
+inline uint8_t checkpointCrc(const Checkpoint& cp) {
+    const uint8_t* p = (const uint8_t*)&cp;
+    uint8_t crc = 0;
+    for (uint8_t i = 0; i < sizeof(Checkpoint) - 1; i++) {
+        crc ^= p[i];
+        for (uint8_t b = 0; b < 8; b++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0x8C : (crc >> 1);
+        }
+    }
+    return crc;
+}
+
+#endif // CHECKPOINT_H
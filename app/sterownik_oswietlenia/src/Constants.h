@@ -2,6 +2,7 @@
 #define CONSTANTS_H
 
 #include <Arduino.h>
+#include "FastPin.h"
 
 // Pin Definitions
 const uint8_t BUTTON_RIGHT_PIN = 12;
@@ -21,10 +22,34 @@ const uint8_t SWITCH_BALLAST_1_PIN = 3;
 const uint8_t SWITCH_BALLAST_2_PIN = 4;
 const uint8_t SWITCH_BALLAST_3_PIN = A3;
 
+// Compile-time pin types for the digital I/O above (see FastPin.h)
+typedef BoardPin<BUTTON_RIGHT_PIN>       ButtonRightPin;
+typedef BoardPin<BUTTON_SET_PIN>         ButtonSetPin;
+typedef BoardPin<BUTTON_MINUS_PIN>       ButtonMinusPin;
+typedef BoardPin<BUTTON_PLUS_PIN>        ButtonPlusPin;
+typedef BoardPin<RTC_RST_PIN>            RtcRstPin;
+typedef BoardPin<SWITCH_TRANSFORMER_PIN> TransformerRelayPin;
+typedef BoardPin<SWITCH_BALLAST_1_PIN>   Ballast1RelayPin;
+typedef BoardPin<SWITCH_BALLAST_2_PIN>   Ballast2RelayPin;
+typedef BoardPin<SWITCH_BALLAST_3_PIN>   Ballast3RelayPin;
+typedef BoardPin<VOLTAGE_OUTPUT_PIN>     VoltageOutputPin;
+typedef BoardPin<A4>                     I2cSdaPin; // hardware TWI, driven directly only for bus recovery
+typedef BoardPin<A5>                     I2cSclPin;
+
+// RTC backend: DS1302 (bit-banged, default) or DS3231 on the LCD's I2C bus - uncomment to switch.
+// The DS3231 has no scratch RAM: its boot checkpoint goes to a wear-levelled EEPROM ring instead.
+// #define RTC_USE_DS3231
+const int8_t DS3231_AGING_OFFSET = 0; // crystal trim written at boot, ~0.1 ppm per LSB
+
 // I2C LCD Configuration
 const uint8_t LCD_ADDRESS = 0x27;
 const uint8_t LCD_COLS = 16;
 const uint8_t LCD_ROWS = 2;
+const uint32_t I2C_CLOCK_HZ = 400000UL; // LCD backpack (+DS3231); PCF8574 is specified for 100kHz - drop to 100000UL if a backpack misbehaves
+const uint32_t I2C_TIMEOUT_US = 5000;     // longest legitimate wait: a 32-byte transaction at 100kHz is ~3ms
+const uint8_t LCD_PUMP_MAX_CELLS = 8;        // cells sent per loop() pass - one Wire buffer, ~0.8ms at 400kHz
+const unsigned long LCD_PUMP_MAX_US = 1000;  // ...or stop after this long, whichever comes first
+const uint8_t LCD_PROBE_CELLS = 2;            // DDRAM cells read back to verify a resync (~0.5ms each)
 
 // EEPROM Addresses
 const int EEPROM_TIMER_START_HOUR_ADDR = 0;
@@ -32,6 +57,12 @@ const int EEPROM_TIMER_START_MINUTE_ADDR = 1;
 const int EEPROM_TIMER_STOP_HOUR_ADDR = 2;
 const int EEPROM_TIMER_STOP_MINUTE_ADDR = 3;
 const int EEPROM_TIMEZONE_ADDR = 4;
+const int EEPROM_FF_MAP_ADDR = 8;   // FeedforwardMap, 23 bytes
+const int EEPROM_BALLAST_MODEL_ADDR = 32; // BallastModel, 7 x 28 bytes
+const int EEPROM_ADC_CAL_ADDR = 228;      // AdcCalibration, 13 bytes
+const int EEPROM_SCRATCH_ADDR = 256;      // EepromScratch checkpoint ring (DS3231), to the end of EEPROM...
+const uint8_t EEPROM_SCRATCH_SLOTS = 48;  // ...48 slots...
+const uint8_t EEPROM_SCRATCH_SLOT_SIZE = 16; // ...of 15 bytes + sequence
 
 // Behavior Constants
 const unsigned long ACTIVITY_BACKLIGHT_SECONDS = 60;
@@ -39,21 +70,92 @@ const unsigned long BUTTON_DEBOUNCE_DELAY = 50; // ms
 const unsigned long LONG_PRESS_DELAY = 500; // ms to trigger a long press
 const unsigned long HOLD_REPEAT_DELAY = 150; // ms between repeats when holding
 const unsigned long SEQUENTIAL_SWITCH_DELAY_MS = 1000; // 1 second between switching ballasts
-const unsigned long RTC_SYNC_INTERVAL_MS = 60000UL; // 60s between RTC hardware reads
-const unsigned long STABILITY_WINDOW_MS = 10000UL;   // continuous window in ±2% before relay switch
+const unsigned long EMI_WINDOW_MS = 500;        // relay blackout: no RTC/I2C traffic, ADC windows discarded
+const uint8_t BOOT_QUORUM_SIZE = 3;             // agreeing RTC reads needed at boot
+const uint8_t BOOT_MAX_READS = 7;               // give up on a quorum after this many reads
+const unsigned long BOOT_READ_SPACING_MS = 30;  // spacing decorrelates boot transients between reads
+const unsigned long RTC_SYNC_INTERVAL_MS = 60000UL; // 60s between RTC hardware reads (minimum, undisciplined)
+const unsigned long RTC_SYNC_MAX_INTERVAL_MS = 900000UL; // 15 min ceiling once millis() drift is disciplined
+const unsigned long DRIFT_MIN_BASELINE_S = 3600;     // RTC 1s resolution -> estimate within ~280 ppm at 1h
+const unsigned long DRIFT_MAX_BASELINE_S = 86400UL;  // re-anchor the drift baseline daily
+const long DRIFT_MAX_PPM = 20000;                    // larger apparent drift = time jump, not resonator error
+const unsigned long CHECKPOINT_INTERVAL_MS = 60000UL; // checkpoint refresh (also on every mask change)
+const unsigned long CHECKPOINT_RESUME_OUTAGE_S = 30;  // outage (reset to boot) that still resumes the checkpointed lit state...
+const unsigned long CHECKPOINT_RESUME_WINDOW_S = CHECKPOINT_INTERVAL_MS / 1000 + CHECKPOINT_RESUME_OUTAGE_S; // ...after a checkpoint up to an interval old
+const long CHECKPOINT_CLOCK_TOLERANCE_S = 5;          // checkpoint time is extrapolated and may lead the RTC by this much
+const float SETTLE_MAX_ERROR = 1.0f;                  // filtered |target - feedback| % for a settled step...
+const float SETTLE_MAX_RATE = 2.0f;                   // ...with the filtered error changing slower than this (%/s)
+const unsigned long SETTLE_TAUS = 5;                  // ...continuously for this many loop time constants
+const unsigned long SETTLE_MIN_WINDOW_MS = 250;       // floor for very fast loops
+const float MASK_HYSTERESIS_POWER = 2.0f;             // system % a mask threshold must be cleared by to change the mask
+const unsigned long BALLAST_MIN_ON_MS = 60000UL;      // a struck ballast stays lit at least this long (cathode wear)...
+const unsigned long BALLAST_MIN_OFF_MS = 30000UL;     // ...and dark at least this long before it is struck again
+// Fault detection: CUSUM over measured - expected feedback, one sample per ADC window. Residual
+// noise of sigma % gives a mean time to false alarm of roughly exp(2 * DRIFT * LIMIT / sigma^2)
+// windows; a persistent residual r > DRIFT alarms after max(LIMIT / (r - DRIFT), PERSIST) windows.
+const float FAULT_CUSUM_DRIFT = 3.0f;            // residual % absorbed per window once the mask's model is trained...
+const float FAULT_CUSUM_DRIFT_UNTRAINED = 15.0f; // ...and while only the shared feedforward map predicts it
+const float FAULT_CUSUM_LIMIT = 30.0f;           // alarm level, % x windows
+const uint8_t FAULT_PERSIST_WINDOWS = 5;         // windows in a row the residual must exceed DRIFT for an alarm (~100 ms)
+const unsigned long PLAN_PRE_DIM_S = 10;              // planned transition: ramp to the post-switch level over this...
+const unsigned long PLAN_SETTLE_S = 3;                // ...then settle there before the boundary
+const unsigned long PLAN_LEAD_S = PLAN_PRE_DIM_S + PLAN_SETTLE_S; // how far ahead the planner looks
 const unsigned long SOFT_START_DURATION_MS = 120000UL; // 2 min ramp on boot/time-jump into active period
 const unsigned long FAN_COOLDOWN_MS = 300000UL; // 5 minutes cooldown after lights off
 const unsigned long TRANSFORMER_WARMUP_MS = 1500; // 1.5s for 1-10V circuit stabilization
 
 // Lighting Control
 const int ANALOG_READ_RESOLUTION = 1023;
+const uint8_t ADC_WINDOW_SAMPLES = 192; // free-running ADC at 9615 Hz: 192 samples = 19.97 ms = one 50 Hz period
+const float ADC_WINDOW_MS = ADC_WINDOW_SAMPLES * 1000.0f / 9615.0f;
+// Supply tracking: between two feedback windows the ADC ISR converts the internal 1.1V bandgap
+// against AVcc. Window timing is unaffected - each window is still one whole mains period.
+const uint8_t BANDGAP_INTERVAL_WINDOWS = 50;  // one measurement per ~1 s
+const uint8_t BANDGAP_SETTLE_SAMPLES = 20;    // conversions discarded while the bandgap settles (~2 ms)
+const uint8_t BANDGAP_SAMPLES = 16;           // conversions averaged
+const float BANDGAP_MIN_COUNTS = 180.0f;      // plausible reading: Vcc ~6.2 V...
+const float BANDGAP_MAX_COUNTS = 300.0f;      // ...to ~3.8 V
+const float BANDGAP_NOMINAL_VOLTS = 1.1f;     // +-10% per part - only for the Vcc shown; corrections use ratios
+const float SUPPLY_FILTER_RATE = 0.1f;        // weight of a new bandgap reading (~10 s memory)
+const float ADC_CAL_MIN_SPAN_VOLTS = 3.0f;    // calibration points must be at least this far apart
 const int ANALOG_WRITE_RESOLUTION = 255;
 
-// Voltage regulation - proportional controller with clamped step
-// Large errors -> fast corrections; small errors -> fine tuning.
-// At ~200Hz: MAX_VOLTAGE_STEP*200 = 20%/s max; near target (<10% error): proportional, quieter.
-const float VOLTAGE_KP       = 0.01f;  // proportional gain (error% -> step%)
-const float MAX_VOLTAGE_STEP = 0.1f;   // max step per call (% of control range)
+// 1-10V feedback scaling: ADC full scale seen through the 2:1 divider, 1V = 0%, 10V = 100%.
+// Nominal values - the AdcCalibration in EEPROM replaces them once the line has been measured.
+const float FEEDBACK_FULL_SCALE_VOLTS = 10.0f;
+const float FEEDBACK_ZERO_VOLTS = 1.0f;
+const float FEEDBACK_SPAN_VOLTS = 9.0f;
+
+// Voltage regulation - PI around a learned feedforward, slew-limited, run by the Timer1 ISR
+// Feedforward puts the output next to its final value at once; PI trims the residual.
+// At 500Hz: MAX_VOLTAGE_STEP*500 = 20%/s max output slew.
+const uint16_t REGULATOR_RATE_HZ = 500;
+const uint8_t PWM_DITHER_BITS = 4;      // 8-bit PWM + 4 dithered bits = 12-bit output; 16-tick pattern >= 31 Hz
+const float VOLTAGE_KP       = 0.5f;   // proportional gain (error% -> output%)
+const float VOLTAGE_KI       = 8.0f;   // integral gain (error% -> output% per second)
+const float MAX_VOLTAGE_STEP = 0.04f;  // max step per tick (% of control range)
+const float FF_LEARN_RATE = 0.1f;                  // share of a settled sample's residual taken into the map
+const float FF_LEARN_MAX_ERROR = 1.0f;             // |target - feedback| (%) below which a point counts as settled
+const unsigned long FF_LEARN_INTERVAL_MS = 1000;   // one map sample per second at most
+const unsigned long FF_MAP_SAVE_INTERVAL_MS = 21600000UL; // EEPROM write of changed maps/models at most every 6h
+// Per-mask 1-10V line model (BallastModel) - seeds the output when a relay changes the load
+const uint8_t MODEL_MIN_SAMPLES = 5;               // settled samples before a mask's model is used
+const float MODEL_LEARN_RATE = 0.1f;               // weight of a new sample in the fit (~10-sample memory)
+const float MODEL_SAMPLE_SPACING = 2.0f;           // output % moved since the last sample before taking another...
+const unsigned long MODEL_SAMPLE_INTERVAL_MS = 60000UL; // ...or this long at a steady output
+const float MODEL_MIN_OUTPUT_VARIANCE = 4.0f;      // output spread (%^2, ~2% SD) needed to refit the gain
+const float MODEL_MIN_GAIN = 0.5f;
+const float MODEL_MAX_GAIN = 2.0f;
+const float MODEL_TAU_MIN_GAP = 0.25f;             // window-to-window change of the feedback gap (%) that counts for tau
+const float MODEL_TAU_LEARN_RATE = 0.05f;
+const uint16_t MODEL_DEFAULT_TAU_MS = 100;
+// Maintenance self-test (LightingController::startSelfTest) - open-loop output steps on each mask
+const uint8_t SELF_TEST_LEVELS = 5;                // scripted output levels per mask (priming level + 4 steps)
+const uint8_t SELF_TEST_DWELL_WINDOWS = 50;        // feedback windows held per level, ~1 s...
+const uint8_t SELF_TEST_TRACE_WINDOWS = 32;        // ...the first kept for rise time and overshoot...
+const uint8_t SELF_TEST_SETTLED_WINDOWS = 16;      // ...the last averaged into the settled feedback
+const float SELF_TEST_MIN_STEP = 5.0f;             // feedback % a step must move for its rise/overshoot to count
+const unsigned long SERIAL_CONSOLE_BAUD = 9600;    // monitor_speed in platformio.ini
 const float MIN_COLD_PER_TUBE_POWER = 50.0f;   // cold-start minimum per-tube % (arc ignition)
 const float MIN_WARM_PER_TUBE_POWER = 5.0f;    // warm operation minimum per-tube % (stable arc)
 const unsigned long TUBE_WARMUP_MS = 300000UL;  // 5 min for tube arc/gas stabilization
@@ -67,6 +169,6 @@ const float CATHODE_WATTS_PER_TUBE = 3.5f;         // cathode heating, constant
 const float ARC_WATTS_PER_TUBE = 50.5f;            // scales linearly with dimming
 
 // UI Constants
-const int MAIN_MENU_SIZE = 5;
+const int MAIN_MENU_SIZE = 6;
 
 #endif // CONSTANTS_H
\ No newline at end of file
@@ -1,58 +1,142 @@
 #ifndef DISPLAY_CONTROLLER_H
 #define DISPLAY_CONTROLLER_H
 
-#include <LiquidCrystal_I2C.h>
+#include <string.h>
+#include "LcdI2C.h"
+#include "EmiWindow.h"
 #include "Constants.h"
 
+// print()/clear() only draw into a frame buffer; pump() (called from update()) sends the
+// cells that differ from a shadow copy of what the LCD already shows, a bounded slice per
+// loop() pass so no screen refresh holds up the rest of the loop.
 class DisplayController {
 public:
     DisplayController(uint8_t addr, uint8_t cols, uint8_t rows) : lcd(addr, cols, rows) {}
 
     void begin() {
-        lcd.init();
-        lcd.backlight();
+        lcd.begin();
+        lcd.setBacklight(true);
+        memset(frame, ' ', sizeof(frame));
+        memset(shadow, ' ', sizeof(shadow)); // init() cleared the glass
+        memset(urgent, 0, sizeof(urgent));
         lastActivityTime = millis();
         isBacklightOn = true;
     }
 
     void update() {
+        // No bus traffic while relays switch; the frame keeps collecting changes meanwhile
+        if (EmiWindow::active()) return;
+
+        // After a relay blackout, or a bus clear that may have cut a transfer mid-nibble
+        bool busRecovered = I2cBus::recoveryCount != seenRecoveries;
+        seenRecoveries = I2cBus::recoveryCount;
+        if (EmiWindow::closedSince(seenEmiWindows) || busRecovered) {
+            resync();
+        }
+        pump();
         if (isBacklightOn && (millis() - lastActivityTime > ACTIVITY_BACKLIGHT_SECONDS * 1000)) {
-            lcd.noBacklight();
+            lcd.setBacklight(false);
             isBacklightOn = false;
         }
     }
 
     void recordActivity() {
         if (!isBacklightOn) {
-            lcd.backlight();
+            if (!EmiWindow::active()) lcd.setBacklight(true); // else applied by the resync after it
             isBacklightOn = true;
         }
         lastActivityTime = millis();
     }
 
-    void print(uint8_t col, uint8_t row, const char* text) {
-        lcd.setCursor(col, row);
-        lcd.print(text);
+    // urgent = edit-mode blink cells: sent ahead of any pending repaint
+    void print(uint8_t col, uint8_t row, const char* text, bool urgent = false) {
+        if (row >= LCD_ROWS) return;
+        while (*text && col < LCD_COLS) {
+            if (urgent) this->urgent[row] |= 1U << col;
+            frame[row][col++] = *text++;
+        }
     }
 
     void clear() {
-        lcd.clear();
+        memset(frame, ' ', sizeof(frame));
     }
 
-    void reinit() {
-        lcd.init();
-        if (isBacklightOn) lcd.backlight();
-        else lcd.noBacklight();
+    // Send changed cells as runs, urgent ones first, until LCD_PUMP_MAX_CELLS cells or
+    // LCD_PUMP_MAX_US have been spent; the rest goes out on the next loop() pass.
+    void pump() {
+        unsigned long start = micros();
+        uint8_t budget = LCD_PUMP_MAX_CELLS;
+        pumpPass(true, start, budget);
+        pumpPass(false, start, budget);
     }
 
+    uint16_t resyncCount = 0;    // cheap resyncs done
+    uint16_t fullInitCount = 0;  // resyncs whose readback probe failed and escalated to init()
+
     bool getBacklightState() {
         return isBacklightOn;
     }
 
+    // Bus cost diagnostics from the driver
+    unsigned long getBytesOnBus() const { return lcd.bytesOnBus; }
+    unsigned long getLastWriteMicros() const { return lcd.lastWriteMicros; }
+
 private:
-    LiquidCrystal_I2C lcd;
+    static const uint8_t MAX_BRIDGED_CELLS = 1; // a cursor move costs about as much as one resent cell
+    static_assert(LCD_COLS <= 16, "urgent[] holds one bit per column");
+
+    LcdI2C lcd;
+    char frame[LCD_ROWS][LCD_COLS];   // what the UI drew
+    char shadow[LCD_ROWS][LCD_COLS];  // what the LCD shows
+    uint16_t urgent[LCD_ROWS];        // per-column bit: blink cell waiting to be sent
     unsigned long lastActivityTime;
     bool isBacklightOn;
+    uint16_t seenRecoveries = 0;
+    uint8_t seenEmiWindows = 0;
+
+    // Re-establish the 4-bit interface, check it by reading the first cells back against the
+    // shadow, and only fall back to a full init() if they differ. Either way the whole frame
+    // is replayed, since the transient may also have hit DDRAM.
+    void resync() {
+        lcd.resync();
+        resyncCount++;
+        // Probe cells not yet replayed after the previous resync (shadow 0) can't be checked
+        char glass[LCD_PROBE_CELLS];
+        bool probeKnown = memchr(shadow[0], 0, LCD_PROBE_CELLS) == nullptr;
+        if (probeKnown && (!lcd.readBack(0, 0, glass, LCD_PROBE_CELLS) ||
+                           memcmp(glass, shadow[0], LCD_PROBE_CELLS) != 0)) {
+            lcd.init();
+            fullInitCount++;
+        }
+        lcd.setBacklight(isBacklightOn);
+        memset(shadow, 0, sizeof(shadow)); // matches no printable cell: pump() resends everything
+    }
+
+    bool pending(uint8_t row, uint8_t col, bool urgentOnly) const {
+        return frame[row][col] != shadow[row][col] && (!urgentOnly || (urgent[row] & (1U << col)));
+    }
+
+    // One cursor move per run; a single unchanged cell between two pending ones is re-sent
+    // rather than paying for another cursor move.
+    void pumpPass(bool urgentOnly, unsigned long start, uint8_t& budget) {
+        for (uint8_t row = 0; row < LCD_ROWS; row++) {
+            uint8_t col = 0;
+            while (col < LCD_COLS) {
+                if (budget == 0 || micros() - start >= LCD_PUMP_MAX_US) return;
+                if (!pending(row, col, urgentOnly)) { col++; continue; }
+                uint8_t end = col + 1;
+                for (uint8_t c = end; c < LCD_COLS && c - end <= MAX_BRIDGED_CELLS && c - col < budget; c++) {
+                    if (pending(row, c, urgentOnly)) end = c + 1;
+                }
+                uint8_t len = end - col;
+                lcd.write(col, row, &frame[row][col], len);
+                memcpy(&shadow[row][col], &frame[row][col], len);
+                urgent[row] &= ~(((1U << len) - 1) << col);
+                budget -= len;
+                col = end;
+            }
+        }
+    }
 };
 
 #endif // DISPLAY_CONTROLLER_H
\ No newline at end of file
@@ -0,0 +1,48 @@
+#ifndef DS1302_RTC_H
+#define DS1302_RTC_H
+
+#include <virtuabotixRTC.h>
+#include "RtcBackend.h"
+
+// DS1302 on three bit-banged lines (virtuabotixRTC), with 31 bytes of battery-backed RAM.
+class Ds1302Rtc : public RtcBackend {
+public:
+    Ds1302Rtc(uint8_t clk, uint8_t dat, uint8_t rst) : rtc(clk, dat, rst) {}
+
+    void begin() override {
+        rtc.begin();
+    }
+
+    // One clock burst read = rollover-consistent snapshot of all clock registers.
+    time_t readTime() override {
+        uint8_t regs[8];
+        rtc.DS1302_clock_burst_read(regs);
+
+        // Reserved bits must read 0; CH (seconds bit 7) and 12h mode (hours bit 7) are never set by us
+        if ((regs[0] & 0x80) || (regs[1] & 0x80) || (regs[2] & 0xC0) ||
+            (regs[3] & 0xC0) || (regs[4] & 0xE0) || (regs[5] & 0xF8)) return 0;
+
+        return bcdToEpoch(regs[0], regs[1], regs[2], regs[3], regs[4], regs[6]);
+    }
+
+    void writeTime(time_t utc) override {
+        rtc.setDS1302Time(::second(utc), ::minute(utc), ::hour(utc), 0, ::day(utc), ::month(utc), ::year(utc));
+    }
+
+    uint8_t scratchSize() const override { return 31; }
+
+    void readScratch(uint8_t* p, uint8_t len) override {
+        rtc.DS1302_ram_burst_read(p, len);
+    }
+
+    void writeScratch(const uint8_t* p, uint8_t len) override {
+        rtc.DS1302_write(DS1302_ENABLE, 0);       // WP off only for the RAM write
+        rtc.DS1302_ram_burst_write((uint8_t*)p, len);
+        rtc.DS1302_write(DS1302_ENABLE, 0x80);
+    }
+
+private:
+    virtuabotixRTC rtc;
+};
+
+#endif // DS1302_RTC_H
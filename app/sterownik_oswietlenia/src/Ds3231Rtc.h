@@ -0,0 +1,154 @@
+#ifndef DS3231_RTC_H
+#define DS3231_RTC_H
+
+#include "I2cBus.h"
+#include "RtcBackend.h"
+#include "EepromScratch.h"
+#include "Constants.h"
+
+// DS3231 TCXO RTC on the hardware TWI bus shared with the LCD backpack.
+// No scratch RAM - the checkpoint goes to EepromScratch; power loss is reported by the chip
+// itself through OSF.
+class Ds3231Rtc : public RtcBackend {
+public:
+    static const uint8_t ADDRESS = 0x68;
+
+    void begin() override {
+        I2cBus::begin();
+        // Trim the crystal with the configured aging offset; CONV applies it without waiting 64 s
+        if (getAgingOffset() != DS3231_AGING_OFFSET) {
+            setAgingOffset(DS3231_AGING_OFFSET);
+        }
+    }
+
+    // One 7-byte TWI read from register 0 = rollover-consistent snapshot (the chip latches on START)
+    time_t readTime() override {
+        uint8_t regs[7];
+        if (!readRegisters(REG_SECONDS, regs, sizeof(regs))) return 0;
+
+        // Reserved bits must read 0; 12h mode and the century bit are never set by us
+        if ((regs[0] & 0x80) || (regs[1] & 0x80) || (regs[2] & 0xC0) ||
+            (regs[3] & 0xF8) || (regs[4] & 0xC0) || (regs[5] & 0xE0)) return 0;
+
+        return bcdToEpoch(regs[0], regs[1], regs[2], regs[4], regs[5], regs[6]);
+    }
+
+    void writeTime(time_t utc) override {
+        tmElements_t tm;
+        breakTime(utc, tm);
+        Wire.beginTransmission(ADDRESS);
+        Wire.write(REG_SECONDS);
+        Wire.write(binToBcd(tm.Second));
+        Wire.write(binToBcd(tm.Minute));
+        Wire.write(binToBcd(tm.Hour));
+        Wire.write(tm.Wday);
+        Wire.write(binToBcd(tm.Day));
+        Wire.write(binToBcd(tm.Month));
+        Wire.write(binToBcd(tmYearToCalendar(tm.Year) - 2000));
+        if (!I2cBus::endTransmission()) return;
+
+        // Time is valid again: clear the oscillator-stop flag
+        uint8_t status;
+        if (readRegisters(REG_STATUS, &status, 1)) {
+            writeRegister(REG_STATUS, status & ~STATUS_OSF);
+        }
+    }
+
+    uint8_t scratchSize() const override { return EepromScratch::SIZE; }
+    void    readScratch(uint8_t* p, uint8_t len) override { EepromScratch::read(p, len); }
+    void    writeScratch(const uint8_t* p, uint8_t len) override { EepromScratch::write(p, len); }
+
+    bool lostPower() override {
+        uint8_t status;
+        return readRegisters(REG_STATUS, &status, 1) && (status & STATUS_OSF);
+    }
+
+    // Die temperature used by the TCXO, 0.25 C resolution, refreshed by the chip every 64 s
+    bool readTemperature(float& celsius) override {
+        uint8_t regs[2];
+        if (!readRegisters(REG_TEMP_MSB, regs, sizeof(regs))) return false;
+        celsius = (int8_t)regs[0] + (regs[1] >> 6) * 0.25f;
+        return true;
+    }
+
+    // Aging offset trims the oscillator, ~0.1 ppm per LSB at 25 C (positive = slower)
+    int8_t getAgingOffset() {
+        uint8_t value = 0;
+        readRegisters(REG_AGING, &value, 1);
+        return (int8_t)value;
+    }
+
+    void setAgingOffset(int8_t offset) {
+        writeRegister(REG_AGING, (uint8_t)offset);
+        uint8_t control;
+        if (readRegisters(REG_CONTROL, &control, 1)) {
+            writeRegister(REG_CONTROL, control | CONTROL_CONV);
+        }
+    }
+
+private:
+    static const uint8_t REG_SECONDS  = 0x00;
+    static const uint8_t REG_CONTROL  = 0x0E;
+    static const uint8_t REG_STATUS   = 0x0F;
+    static const uint8_t REG_AGING    = 0x10;
+    static const uint8_t REG_TEMP_MSB = 0x11;
+    static const uint8_t CONTROL_CONV = 0x20;
+    static const uint8_t STATUS_OSF   = 0x80;
+
+    bool readRegisters(uint8_t reg, uint8_t* p, uint8_t len) {
+        Wire.beginTransmission(ADDRESS);
+        Wire.write(reg);
+        if (!I2cBus::endTransmission(false)) return false;
+        if (!I2cBus::requestFrom(ADDRESS, len)) return false;
+        for (uint8_t i = 0; i < len; i++) p[i] = Wire.read();
+        return true;
+    }
+
+    void writeRegister(uint8_t reg, uint8_t value) {
+        Wire.beginTransmission(ADDRESS);
+        Wire.write(reg);
+        Wire.write(value);
+        I2cBus::endTransmission();
+    }
+};
+
+#ifndef __AVR__
+// Host build stand-in for the DS3231: free-running clock on millis(), trimmed by the aging offset.
+class SimulatedDs3231 : public RtcBackend {
+public:
+    float   temperature = 25.0f;
+    int8_t  agingOffset = DS3231_AGING_OFFSET;
+    bool    oscillatorStopped = true;
+
+    void begin() override {}
+
+    time_t readTime() override {
+        unsigned long elapsedMs = millis() - baseMillis;
+        float rate = 1.0f - agingOffset * 0.1e-6f;
+        return baseTime + (time_t)(elapsedMs * rate / 1000.0f);
+    }
+
+    void writeTime(time_t utc) override {
+        baseTime = utc;
+        baseMillis = millis();
+        oscillatorStopped = false;
+    }
+
+    uint8_t scratchSize() const override { return EepromScratch::SIZE; }
+    void    readScratch(uint8_t* p, uint8_t len) override { EepromScratch::read(p, len); }
+    void    writeScratch(const uint8_t* p, uint8_t len) override { EepromScratch::write(p, len); }
+
+    bool lostPower() override { return oscillatorStopped; }
+
+    bool readTemperature(float& celsius) override {
+        celsius = temperature;
+        return true;
+    }
+
+private:
+    time_t        baseTime = RtcBackend::EPOCH_2000;
+    unsigned long baseMillis = 0;
+};
+#endif
+
+#endif // DS3231_RTC_H
@@ -0,0 +1,50 @@
+#ifndef EEPROM_SCRATCH_H
+#define EEPROM_SCRATCH_H
+
+#include <EEPROM.h>
+#include "Constants.h"
+
+// Checkpoint storage in the ATmega's own EEPROM, for RTC chips without scratch RAM (DS3231).
+// A ring of EEPROM_SCRATCH_SLOTS slots, each the payload plus a sequence byte written last:
+// every write goes to the slot after the newest, so each slot takes 1/SLOTS of the writes -
+// at one checkpoint a minute ~30 a day, about 9 years to the 100k-cycle rating - and a write
+// cut short by a reset leaves the previous slot the newest. Unlike RTC RAM it survives an RTC
+// power loss; the DS3231 reports that through its oscillator-stop flag instead.
+class EepromScratch {
+public:
+    static const uint8_t SIZE = EEPROM_SCRATCH_SLOT_SIZE - 1;
+
+    static void read(uint8_t* p, uint8_t len) {
+        int addr = slotAddress(newest());
+        for (uint8_t i = 0; i < len && i < SIZE; i++) p[i] = EEPROM.read(addr + i);
+    }
+
+    static void write(const uint8_t* p, uint8_t len) {
+        uint8_t head = newest();
+        uint8_t sequence = EEPROM.read(slotAddress(head) + SIZE) + 1;
+        int addr = slotAddress((head + 1) % EEPROM_SCRATCH_SLOTS);
+        for (uint8_t i = 0; i < len && i < SIZE; i++) EEPROM.update(addr + i, p[i]);
+        EEPROM.update(addr + SIZE, sequence);
+    }
+
+private:
+    static int slotAddress(uint8_t slot) {
+        return EEPROM_SCRATCH_ADDR + slot * EEPROM_SCRATCH_SLOT_SIZE;
+    }
+
+    // Sequence numbers count up by one from slot 0 to the newest; the slot after it still holds
+    // one from the previous lap (SLOTS is no multiple of 256, so it never continues the run)
+    static uint8_t newest() {
+        uint8_t head = 0;
+        uint8_t sequence = EEPROM.read(slotAddress(0) + SIZE);
+        for (uint8_t i = 1; i < EEPROM_SCRATCH_SLOTS; i++) {
+            uint8_t next = EEPROM.read(slotAddress(i) + SIZE);
+            if (next != (uint8_t)(sequence + 1)) break;
+            head = i;
+            sequence = next;
+        }
+        return head;
+    }
+};
+
+#endif // EEPROM_SCRATCH_H
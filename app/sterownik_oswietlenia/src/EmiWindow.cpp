@@ -0,0 +1,24 @@
+#include "EmiWindow.h"
+
+volatile bool EmiWindow::blackout = false;
+uint16_t EmiWindow::windowCount = 0;
+uint8_t EmiWindow::closedCount = 0;
+unsigned long EmiWindow::endMs = 0;
+
+void EmiWindow::announce(unsigned long durationMs) {
+    unsigned long until = millis() + durationMs;
+    if (!blackout) {
+        windowCount++;
+        endMs = until;
+        blackout = true;
+    } else if ((long)(until - endMs) > 0) {
+        endMs = until; // back-to-back relay actions merge into one window
+    }
+}
+
+void EmiWindow::update() {
+    if (blackout && (long)(millis() - endMs) >= 0) {
+        blackout = false;
+        closedCount++;
+    }
+}
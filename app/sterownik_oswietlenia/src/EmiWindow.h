@@ -0,0 +1,37 @@
+#ifndef EMI_WINDOW_H
+#define EMI_WINDOW_H
+
+#include <Arduino.h>
+#include "Constants.h"
+
+// Relay EMI blackout shared by everything that touches a bus or samples the ADC.
+// Relay code announces a window right before it switches; while it is open, RTC reads and
+// checkpoint writes are deferred, the LCD is left alone, and ADC windows overlapping it are
+// discarded. Deferred work runs on the first loop() pass after it closes (closedSince()).
+class EmiWindow {
+public:
+    // Open (or extend) a blackout starting now - call before energising/releasing a relay
+    static void announce(unsigned long durationMs = EMI_WINDOW_MS);
+
+    // From loop(): closes the window once it has expired
+    static void update();
+
+    static bool active() { return blackout; }
+
+    // True once per window closed since 'seen' was last updated - the caller's cue to run
+    // whatever it deferred
+    static bool closedSince(uint8_t& seen) {
+        if (seen == closedCount) return false;
+        seen = closedCount;
+        return true;
+    }
+
+    static volatile bool blackout;  // plain flag so ISRs can test it cheaply
+    static uint16_t windowCount;    // windows announced (merged extensions not counted)
+
+private:
+    static uint8_t closedCount;
+    static unsigned long endMs;
+};
+
+#endif // EMI_WINDOW_H
@@ -0,0 +1,54 @@
+#ifndef FAST_PIN_H
+#define FAST_PIN_H
+
+#include <Arduino.h>
+
+// Compile-time pin access for the ATmega328P (Nano).
+// Arduino pins 0-7 = PORTD, 8-13 = PORTB, A0-A5 (14-19) = PORTC. With the pin
+// known at compile time the register and bit fold to constants, so each call is
+// a single sbi/cbi/sbis instead of digitalWrite/digitalRead's table lookups.
+#ifdef __AVR__
+template<uint8_t PIN>
+struct AvrPin {
+    static_assert(PIN < 20, "AvrPin: ATmega328P has digital pins 0-19 only");
+
+    static const uint8_t number = PIN;
+    static const uint8_t mask = 1 << (PIN < 8 ? PIN : (PIN < 14 ? PIN - 8 : PIN - 14));
+
+    static volatile uint8_t& port() { return PIN < 8 ? PORTD : (PIN < 14 ? PORTB : PORTC); }
+    static volatile uint8_t& ddr()  { return PIN < 8 ? DDRD  : (PIN < 14 ? DDRB  : DDRC); }
+    static volatile uint8_t& in()   { return PIN < 8 ? PIND  : (PIN < 14 ? PINB  : PINC); }
+
+    static void output()      { ddr() |= mask; }
+    static void input()       { ddr() &= ~mask; }
+    static void high()        { port() |= mask; }
+    static void low()         { port() &= ~mask; }
+    static void write(bool v) { if (v) high(); else low(); }
+    static bool read()        { return (in() & mask) != 0; }
+};
+#endif
+
+// Same interface backed by plain variables, for building the controllers on a host.
+template<uint8_t PIN>
+struct FakePin {
+    static const uint8_t number = PIN;
+    static bool level;
+    static bool isOutput;
+
+    static void output()      { isOutput = true; }
+    static void input()       { isOutput = false; }
+    static void high()        { level = true; }
+    static void low()         { level = false; }
+    static void write(bool v) { level = v; }
+    static bool read()        { return level; }
+};
+template<uint8_t PIN> bool FakePin<PIN>::level = false;
+template<uint8_t PIN> bool FakePin<PIN>::isOutput = false;
+
+#ifdef __AVR__
+template<uint8_t PIN> using BoardPin = AvrPin<PIN>;
+#else
+template<uint8_t PIN> using BoardPin = FakePin<PIN>;
+#endif
+
+#endif // FAST_PIN_H
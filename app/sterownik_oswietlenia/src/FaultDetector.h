@@ -0,0 +1,52 @@
+#ifndef FAULT_DETECTOR_H
+#define FAULT_DETECTOR_H
+
+#include <Arduino.h>
+#include "Constants.h"
+
+// Two-sided CUSUM over the residual between the feedback the commanded output should produce
+// and the feedback measured, one sample per feedback window. The expectation runs through the
+// loop's first-order lag, so regulator steps and slews leave no residual. A dead circuit,
+// feedback stuck while the output moves, or a collapsed gain all leave a residual that
+// persists beyond the drift allowance and add up within a few windows. Noise and model
+// error below the allowance drain away again. An alarm also needs the residual beyond the
+// allowance, on the same side, for the last FAULT_PERSIST_WINDOWS windows in a row - a single
+// wild window (mains spike, a glitch the blackout missed) fills the sum but not the run.
+class FaultDetector {
+public:
+    float expected = 0.0f;  // predicted feedback, %
+    float high = 0.0f;      // accumulated excess of feedback above the prediction, % x windows
+    float low = 0.0f;       // ...and below it
+    uint8_t highRun = 0;    // windows in a row with the residual above +drift
+    uint8_t lowRun = 0;     // ...and below -drift
+
+    void reset() {
+        primed = false;
+        high = low = 0.0f;
+        highRun = lowRun = 0;
+    }
+
+    // 'settledFeedback': where the output held over the last window settles. The first sample
+    // after a reset starts the prediction there - call reset() on any gap in the windows, as
+    // the output held across it is unknown. True on alarm.
+    bool sample(float settledFeedback, float feedback, unsigned long tauMs, float drift) {
+        if (!primed) {
+            expected = settledFeedback;
+            primed = true;
+        } else {
+            expected += (1.0f - exp(-ADC_WINDOW_MS / tauMs)) * (settledFeedback - expected);
+        }
+        float residual = feedback - expected;
+        high = max(0.0f, high + residual - drift);
+        low = max(0.0f, low - residual - drift);
+        highRun = residual > drift ? min(highRun + 1, 255) : 0;
+        lowRun = residual < -drift ? min(lowRun + 1, 255) : 0;
+        return (high > FAULT_CUSUM_LIMIT && highRun >= FAULT_PERSIST_WINDOWS) ||
+               (low > FAULT_CUSUM_LIMIT && lowRun >= FAULT_PERSIST_WINDOWS);
+    }
+
+private:
+    bool primed = false;
+};
+
+#endif // FAULT_DETECTOR_H
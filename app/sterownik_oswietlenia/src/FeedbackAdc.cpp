@@ -0,0 +1,130 @@
+#include "FeedbackAdc.h"
+#include "Constants.h"
+#include "EmiWindow.h"
+
+#ifdef __AVR__
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+static const uint8_t     FEEDBACK_MUX = _BV(REFS0) | (VOLTAGE_FEEDBACK_PIN - A0); // AVcc reference, same as analogRead()
+static const uint8_t     BANDGAP_MUX = _BV(REFS0) | 0x0E;                        // internal 1.1V bandgap against AVcc
+
+static volatile uint32_t lastSum = 0;     // last finished window
+static volatile uint8_t  windows = 0;     // sequence number of that window
+static uint8_t           sequence = 0;    // ISR-only: windows finished, dropped ones included
+static volatile uint16_t lastBandgap = 0; // last finished bandgap measurement
+static volatile uint8_t  bandgaps = 0;
+static uint32_t          accumulator = 0; // ISR-only
+static uint8_t           samples = 0;     // ISR-only
+static bool              tainted = false; // ISR-only: window overlaps a relay blackout
+static uint8_t           slot = 0;        // ISR-only: conversions into a bandgap slot, 0 = none running
+static uint8_t           sinceBandgap = 0; // ISR-only: windows since the last slot
+
+void FeedbackAdc::begin() {
+    uint8_t channel = VOLTAGE_FEEDBACK_PIN - A0;
+    DIDR0 |= _BV(channel);                       // analog-only pin: no digital input buffer leakage
+    ADMUX = FEEDBACK_MUX;
+    ADCSRB = 0;                                  // free-running trigger
+    ADCSRA = _BV(ADEN) | _BV(ADSC) | _BV(ADATE) | _BV(ADIE) |
+             _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0); // /128 = 125 kHz ADC clock, 13 cycles per sample
+
+    // Wait for the first window so the controllers never start on an empty reading (~21 ms)
+    uint8_t start = windows;
+    unsigned long t0 = millis();
+    while (windows == start && millis() - t0 < 50) {}
+}
+
+uint32_t FeedbackAdc::windowSum() {
+    uint32_t sum;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        sum = lastSum;
+    }
+    return sum;
+}
+
+float FeedbackAdc::average() {
+    return windowSum() / (float)ADC_WINDOW_SAMPLES;
+}
+
+uint8_t FeedbackAdc::windowCount() {
+    return windows;
+}
+
+uint16_t FeedbackAdc::bandgapSum() {
+    uint16_t sum;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        sum = lastBandgap;
+    }
+    return sum;
+}
+
+uint8_t FeedbackAdc::bandgapCount() {
+    return bandgaps;
+}
+
+// In free-running mode a new ADMUX only applies from the conversion after the one already
+// started, so one conversion of the old channel follows each switch. Slot layout, counted in
+// conversions after switching to the bandgap: 1 old channel, BANDGAP_SETTLE_SAMPLES settling,
+// BANDGAP_SAMPLES summed, then back to the feedback pin with one bandgap and one settling
+// conversion discarded.
+static const uint8_t SLOT_SUM_FROM = 2 + BANDGAP_SETTLE_SAMPLES;
+static const uint8_t SLOT_SUM_TO = SLOT_SUM_FROM + BANDGAP_SAMPLES - 1;
+static const uint8_t SLOT_END = SLOT_SUM_TO + 2;
+
+// 'slot' is the number of the conversion being handed in
+static void bandgapSlot(uint16_t value) {
+    static uint16_t sum = 0;
+    if (slot == 1) sum = 0;
+    if (slot >= SLOT_SUM_FROM && slot <= SLOT_SUM_TO) sum += value;
+    if (EmiWindow::blackout) tainted = true;
+    if (slot == SLOT_SUM_TO) {
+        ADMUX = FEEDBACK_MUX;
+        if (!tainted) {
+            lastBandgap = sum;
+            bandgaps++;
+        }
+    }
+    if (slot == SLOT_END) {
+        slot = 0;
+        tainted = false;
+    } else {
+        slot++;
+    }
+}
+
+ISR(ADC_vect) {
+    uint16_t value = ADC;
+    if (slot != 0) {
+        bandgapSlot(value);
+        return;
+    }
+    accumulator += value;
+    if (EmiWindow::blackout) tainted = true;
+    if (++samples >= ADC_WINDOW_SAMPLES) {
+        // Windows touched by relay switching are dropped; readers keep the last clean one and
+        // see the gap in its sequence number
+        sequence++;
+        if (!tainted) {
+            lastSum = accumulator;
+            windows = sequence;
+        }
+        tainted = false;
+        accumulator = 0;
+        samples = 0;
+        if (++sinceBandgap >= BANDGAP_INTERVAL_WINDOWS) {
+            sinceBandgap = 0;
+            ADMUX = BANDGAP_MUX;
+            slot = 1;
+        }
+    }
+}
+
+#else
+// Host build: no ADC interrupt, fall back to a direct read
+void FeedbackAdc::begin() {}
+float FeedbackAdc::average() { return analogRead(VOLTAGE_FEEDBACK_PIN); }
+uint32_t FeedbackAdc::windowSum() { return (uint32_t)analogRead(VOLTAGE_FEEDBACK_PIN) * ADC_WINDOW_SAMPLES; }
+uint8_t FeedbackAdc::windowCount() { static uint8_t n = 0; return ++n; }
+uint16_t FeedbackAdc::bandgapSum() { return 0; }
+uint8_t FeedbackAdc::bandgapCount() { return 0; } // no bandgap channel: the supply is taken as calibrated
+#endif
@@ -0,0 +1,31 @@
+#ifndef FEEDBACK_ADC_H
+#define FEEDBACK_ADC_H
+
+#include <Arduino.h>
+
+// 1-10V feedback sampled by the ADC in free-running mode.
+// The ADC ISR (FeedbackAdc.cpp) sums ADC_WINDOW_SAMPLES conversions, one mains
+// period, so 100 Hz rectifier ripple averages out and the mean gains ~3 bits.
+// Readers only copy the last finished window - no analogRead, no waiting.
+// Every BANDGAP_INTERVAL_WINDOWS windows the ISR converts the internal bandgap in between two
+// windows, a supply (AVcc) measurement for LightingController to correct the feedback scale.
+class FeedbackAdc {
+public:
+    static void begin();
+
+    // Mean of the last mains window in ADC counts (0-1023, fractional)
+    static float average();
+
+    // Raw sum of the last mains window (ADC_WINDOW_SAMPLES conversions)
+    static uint32_t windowSum();
+
+    // Sequence number of the last window: changes once per clean window, so callers can skip
+    // unchanged data, and jumps by more than one over windows dropped in a relay blackout
+    static uint8_t windowCount();
+
+    // Last bandgap measurement: sum of BANDGAP_SAMPLES conversions, and its count as above
+    static uint16_t bandgapSum();
+    static uint8_t  bandgapCount();
+};
+
+#endif // FEEDBACK_ADC_H
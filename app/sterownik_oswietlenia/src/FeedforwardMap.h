@@ -0,0 +1,90 @@
+#ifndef FEEDFORWARD_MAP_H
+#define FEEDFORWARD_MAP_H
+
+#include <EEPROM.h>
+#include "Debug.h"
+#include "Constants.h"
+
+// Measured output -> feedback curve of the 1-10V stage, 11 points at 0, 10, ... 100% output.
+// Inverted it gives the output that should produce a requested feedback level, so the PI
+// regulator only has to trim the residual. Learned online from settled operating points and
+// kept in EEPROM; an unprogrammed or corrupt copy starts from the ideal (identity) curve.
+struct FeedforwardMap {
+    static const uint8_t POINTS = 11;
+
+    uint16_t feedback[POINTS];  // feedback at each output point, centi-percent
+    uint8_t  checksum;
+
+    void setDefaults() {
+        for (uint8_t i = 0; i < POINTS; i++) feedback[i] = i * 1000;
+    }
+
+    void load() {
+        EEPROM.get(EEPROM_FF_MAP_ADDR, *this);
+        bool valid = checksum == computeChecksum();
+        for (uint8_t i = 0; i < POINTS && valid; i++) valid = feedback[i] <= 10000;
+        if (!valid) {
+            DEBUG_PRINTLN("FF map: invalid, using defaults");
+            setDefaults();
+        }
+    }
+
+    void save() {
+        checksum = computeChecksum();
+        EEPROM.put(EEPROM_FF_MAP_ADDR, *this); // put() only rewrites bytes that changed
+    }
+
+    // Output (0-100%) expected to produce 'feedbackPercent', by inverse interpolation
+    float outputFor(float feedbackPercent) const {
+        float target = feedbackPercent * 100.0f;
+        if (target <= feedback[0]) return 0.0f;
+        for (uint8_t i = 1; i < POINTS; i++) {
+            if (target <= feedback[i]) {
+                float span = feedback[i] - feedback[i - 1];
+                float frac = (span > 0) ? (target - feedback[i - 1]) / span : 0.0f;
+                return (i - 1 + frac) * 10.0f;
+            }
+        }
+        return 100.0f;
+    }
+
+    // Feedback (0-100%) that 'outputPercent' is expected to produce
+    float feedbackFor(float outputPercent) const {
+        float pos = constrain(outputPercent, 0.0f, 100.0f) / 10.0f;
+        uint8_t i = min((uint8_t)pos, (uint8_t)(POINTS - 2));
+        float w = pos - i;
+        return (feedback[i] + (feedback[i + 1] - (float)feedback[i]) * w) / 100.0f;
+    }
+
+    // Pull the two neighbouring points towards a settled (output, feedback) sample, weighted by
+    // distance, then keep the curve monotonic so it stays invertible
+    void learn(float outputPercent, float feedbackPercent) {
+        float pos = constrain(outputPercent, 0.0f, 100.0f) / 10.0f;
+        uint8_t i = min((uint8_t)pos, (uint8_t)(POINTS - 2));
+        float w = pos - i;
+        float residual = (feedbackPercent - feedbackFor(outputPercent)) * 100.0f;
+        feedback[i]     = clampPoint(feedback[i] + FF_LEARN_RATE * (1.0f - w) * residual);
+        feedback[i + 1] = clampPoint(feedback[i + 1] + FF_LEARN_RATE * w * residual);
+        for (uint8_t k = 1; k < POINTS; k++) {
+            if (feedback[k] < feedback[k - 1]) feedback[k] = feedback[k - 1];
+        }
+    }
+
+    // The feedback scale changed (new ADC calibration): new % = scale * old % + shift
+    void rescaleFeedback(float scale, float shift) {
+        for (uint8_t i = 0; i < POINTS; i++) feedback[i] = clampPoint(feedback[i] * scale + shift * 100.0f);
+    }
+
+private:
+    static uint16_t clampPoint(float v) {
+        return (uint16_t)constrain(v + 0.5f, 0.0f, 10000.0f);
+    }
+
+    uint8_t computeChecksum() const {
+        uint8_t sum = 0xA5;
+        for (uint8_t i = 0; i < POINTS; i++) sum += (feedback[i] & 0xFF) + (feedback[i] >> 8);
+        return sum;
+    }
+};
+
+#endif // FEEDFORWARD_MAP_H
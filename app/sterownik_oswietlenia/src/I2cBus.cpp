@@ -0,0 +1,65 @@
+#include "I2cBus.h"
+#include "Constants.h"
+
+uint16_t I2cBus::nackCount = 0;
+uint16_t I2cBus::timeoutCount = 0;
+uint16_t I2cBus::recoveryCount = 0;
+
+void I2cBus::begin() {
+    Wire.begin();
+    Wire.setClock(I2C_CLOCK_HZ);                 // Wire.begin() resets the bus to 100kHz
+    Wire.setWireTimeout(I2C_TIMEOUT_US, true);   // reset the TWI unit when a wait times out
+}
+
+bool I2cBus::endTransmission(bool sendStop) {
+    uint8_t status = Wire.endTransmission(sendStop);
+    if (status == 0) return true;
+
+    if (status == 5 || Wire.getWireTimeoutFlag()) {
+        Wire.clearWireTimeoutFlag();
+        timeoutCount++;
+        recover();
+    } else if (status == 4) {
+        recover(); // bus error / lost arbitration: the bus state is unknown
+    } else {
+        nackCount++;
+    }
+    return false;
+}
+
+bool I2cBus::requestFrom(uint8_t address, uint8_t len) {
+    if (Wire.requestFrom(address, len) == len) return true;
+
+    if (Wire.getWireTimeoutFlag()) {
+        Wire.clearWireTimeoutFlag();
+        timeoutCount++;
+        recover();
+    } else {
+        nackCount++;
+    }
+    return false;
+}
+
+// Standard bus clear (I2C spec 3.1.16): with the TWI off, pulse SCL up to 9 times so a slave
+// stuck mid-byte finishes shifting and releases SDA, then issue a STOP. Both lines are driven
+// open-drain: output LOW to pull down, input to release to the pull-ups.
+void I2cBus::recover() {
+    recoveryCount++;
+    Wire.end();
+
+    I2cSdaPin::low(); I2cSdaPin::input();
+    I2cSclPin::low(); I2cSclPin::input();
+
+    for (uint8_t i = 0; i < 9 && !I2cSdaPin::read(); i++) {
+        I2cSclPin::output(); delayMicroseconds(5);
+        I2cSclPin::input();  delayMicroseconds(5);
+    }
+
+    // STOP: SDA rises while SCL is high
+    I2cSclPin::output(); delayMicroseconds(5);
+    I2cSdaPin::output(); delayMicroseconds(5);
+    I2cSclPin::input();  delayMicroseconds(5);
+    I2cSdaPin::input();  delayMicroseconds(5);
+
+    begin();
+}
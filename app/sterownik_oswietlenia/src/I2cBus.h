@@ -0,0 +1,27 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// Wire with a per-transaction timeout and bus-clear recovery, shared by the LCD backpack and
+// the DS3231. A slave left mid-byte by relay EMI can hold SDA low forever; instead of waiting
+// for the watchdog, a timed-out or failed transaction clocks SCL until SDA is released
+// (I2cBus.cpp) and re-initialises the TWI - a few hundred microseconds.
+class I2cBus {
+public:
+    static void begin();
+
+    // Same contract as Wire.endTransmission()/requestFrom(), with failures counted and recovered
+    static bool endTransmission(bool sendStop = true);
+    static bool requestFrom(uint8_t address, uint8_t len);
+
+    static void recover();
+
+    // Diagnostics
+    static uint16_t nackCount;      // slave did not acknowledge (absent, busy, or garbled address)
+    static uint16_t timeoutCount;   // transaction exceeded I2C_TIMEOUT_US
+    static uint16_t recoveryCount;  // bus clears performed - LCD contents are suspect after one
+};
+
+#endif // I2C_BUS_H
@@ -0,0 +1,9 @@
+#include "InputManager.h"
+
+#ifdef __AVR__
+#include <avr/interrupt.h>
+
+ISR(PCINT0_vect) {
+    InputManager::isr();
+}
+#endif
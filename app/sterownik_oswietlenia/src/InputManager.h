@@ -2,6 +2,12 @@
 #define INPUT_MANAGER_H
 
 #include "Constants.h"
+#include "EmiWindow.h"
+#ifdef __AVR__
+#include <util/atomic.h>
+#else
+#define ATOMIC_BLOCK(type)
+#endif
 
 enum Button {
     BTN_NONE, BTN_RIGHT, BTN_SET, BTN_MINUS, BTN_PLUS
@@ -13,76 +19,148 @@ enum ButtonEvent {
     EVENT_HOLD   // Long press / repeat
 };
 
-class InputManager {
+struct ButtonAction {
+    Button button;
+    ButtonEvent event;
+};
+
+// Buttons are parameterised on compile-time pin types (see FastPin.h).
+// Edges arrive through the PCINT0 interrupt (InputManager.cpp), which only stamps them; a level
+// counts once it has held for BUTTON_DEBOUNCE_DELAY - confirmed by next(), or by the ISR when
+// the next edge ends it - so bounces and relay spikes never make a press. Edges inside a relay
+// EMI window are dropped outright. Presses go into a small lock-free queue, so a tap made during
+// a long display or RTC operation is still delivered. Hold repeats are derived from the press
+// timestamp when polled.
+template<class RightPin, class SetPin, class MinusPin, class PlusPin>
+class InputManagerT {
 public:
-    InputManager() {
-        pinMode(BUTTON_RIGHT_PIN, INPUT);
-        pinMode(BUTTON_SET_PIN, INPUT);
-        pinMode(BUTTON_MINUS_PIN, INPUT);
-        pinMode(BUTTON_PLUS_PIN, INPUT);
+    InputManagerT() {
+        RightPin::input();
+        SetPin::input();
+        MinusPin::input();
+        PlusPin::input();
+    }
+
+    uint8_t droppedEvents = 0; // presses lost to a full queue
+
+    void begin() {
+        instance = this;
+#ifdef __AVR__
+        // Pins 8-13 = PORTB = PCINT0-5; PCMSK0 bits equal the PORTB bit masks
+        static_assert(RightPin::number >= 8 && RightPin::number < 14 && SetPin::number >= 8 && SetPin::number < 14 &&
+                      MinusPin::number >= 8 && MinusPin::number < 14 && PlusPin::number >= 8 && PlusPin::number < 14,
+                      "buttons must share the PCINT0 port (pins 8-13)");
+        PCMSK0 |= RightPin::mask | SetPin::mask | MinusPin::mask | PlusPin::mask;
+        PCIFR = _BV(PCIF0);
+        PCICR |= _BV(PCIE0);
+#endif
+    }
+
+    // Called by the PCINT0 ISR
+    static void isr() {
+        if (instance && !EmiWindow::blackout) instance->onPinChange(readLevels(), millis());
     }
 
-    ButtonEvent checkButton(Button btn, ButtonEvent& event) {
-        event = EVENT_NONE;
-        uint8_t index = btn - 1;
-        bool currentState = (digitalRead(buttonPins[index]) == HIGH);
+    // Next event: queued presses first, then hold repeats for buttons still held
+    ButtonAction next() {
+        // Stamp any edge the ISR did not see (dropped in an EMI window; host builds have no PCINT
+        // and rely on this alone), then confirm levels that have held long enough
+        unsigned long now = millis();
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            if (!EmiWindow::active()) onPinChange(readLevels(), now);
+            for (uint8_t i = 0; i < 4; i++) confirm(i, now);
+        }
 
-        if (currentState != buttonStates[index].lastReading) {
-            buttonStates[index].lastDebounceTime = millis();
+        if (tail != head) {
+            Button btn = (Button)queue[tail];
+            tail = (tail + 1) & (QUEUE_SIZE - 1);
+            return {btn, EVENT_PRESS};
         }
-        buttonStates[index].lastReading = currentState;
-
-        if ((millis() - buttonStates[index].lastDebounceTime) > BUTTON_DEBOUNCE_DELAY) {
-            if (currentState && !buttonStates[index].isPressed) { // Button just pressed
-                buttonStates[index].isPressed = true;
-                buttonStates[index].pressTime = millis();
-                event = EVENT_PRESS;
-            } else if (currentState && buttonStates[index].isPressed) { // Button is being held
-                if ((millis() - buttonStates[index].pressTime) > LONG_PRESS_DELAY) {
-                    if ((millis() - buttonStates[index].lastRepeatTime) > HOLD_REPEAT_DELAY) {
-                        buttonStates[index].lastRepeatTime = millis();
-                        event = EVENT_HOLD;
-                    }
-                }
-            } else if (!currentState && buttonStates[index].isPressed) { // Button released
-                buttonStates[index].isPressed = false;
+
+        for (uint8_t i = 0; i < 4; i++) {
+            bool pressed;
+            unsigned long pressTime;
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                pressed = states[i].pressed;
+                pressTime = states[i].pressTime;
+            }
+            if (pressed && now - pressTime > LONG_PRESS_DELAY && now - lastRepeatTime[i] > HOLD_REPEAT_DELAY) {
+                lastRepeatTime[i] = now;
+                return {(Button)(i + 1), EVENT_HOLD};
             }
         }
-
-        return event;
+        return {BTN_NONE, EVENT_NONE};
     }
 
 private:
     struct ButtonState {
-        bool isPressed = false;
-        bool lastReading = false;
+        bool level = false;           // last level seen, not yet confirmed
+        bool pressed = false;         // confirmed level
+        unsigned long edgeTime = 0;   // when 'level' was first seen
         unsigned long pressTime = 0;
-        unsigned long lastDebounceTime = 0;
-        unsigned long lastRepeatTime = 0;
     };
 
-    const uint8_t buttonPins[4] = {BUTTON_RIGHT_PIN, BUTTON_SET_PIN, BUTTON_MINUS_PIN, BUTTON_PLUS_PIN};
-    ButtonState buttonStates[4];
-};
+    static const uint8_t QUEUE_SIZE = 8; // power of two
 
-struct ButtonAction {
-    Button button;
-    ButtonEvent event;
+    static InputManagerT* instance;
+
+    volatile ButtonState states[4];
+    unsigned long lastRepeatTime[4] = {0, 0, 0, 0}; // loop() only
+    uint8_t queue[QUEUE_SIZE];
+    volatile uint8_t head = 0;  // written with interrupts off only
+    volatile uint8_t tail = 0;  // written by loop() only
+
+    // Bit (button - 1) set = pressed (buttons are active HIGH)
+    static uint8_t readLevels() {
+        return (RightPin::read() ? 0x01 : 0) | (SetPin::read() ? 0x02 : 0) |
+               (MinusPin::read() ? 0x04 : 0) | (PlusPin::read() ? 0x08 : 0);
+    }
+
+    // Interrupts off: from the ISR or inside next()'s atomic block
+    void onPinChange(uint8_t levels, unsigned long now) {
+        for (uint8_t i = 0; i < 4; i++) {
+            volatile ButtonState& b = states[i];
+            bool down = levels & (1 << i);
+            if (down == b.level) continue;
+            confirm(i, now); // the level this edge ends counts if it held long enough
+            b.level = down;
+            b.edgeTime = now;
+        }
+    }
+
+    // Interrupts off: adopts the last level seen once it has held for BUTTON_DEBOUNCE_DELAY
+    void confirm(uint8_t i, unsigned long now) {
+        volatile ButtonState& b = states[i];
+        if (b.level == b.pressed || now - b.edgeTime < BUTTON_DEBOUNCE_DELAY) return;
+        b.pressed = b.level;
+        if (b.pressed) {
+            b.pressTime = b.edgeTime;
+            push(i + 1);
+        }
+    }
+
+    void push(uint8_t btn) {
+        uint8_t next = (head + 1) & (QUEUE_SIZE - 1);
+        if (next == tail) {
+            droppedEvents++;
+            return;
+        }
+        queue[head] = btn;
+        head = next;
+    }
 };
 
+template<class RightPin, class SetPin, class MinusPin, class PlusPin>
+InputManagerT<RightPin, SetPin, MinusPin, PlusPin>* InputManagerT<RightPin, SetPin, MinusPin, PlusPin>::instance = nullptr;
+
+typedef InputManagerT<ButtonRightPin, ButtonSetPin, ButtonMinusPin, ButtonPlusPin> InputManager;
+
 class InputProcessor {
 public:
     InputProcessor(InputManager& manager) : inputManager(manager) {}
 
     ButtonAction getAction() {
-        ButtonEvent event;
-        for (int i = 0; i < 4; i++) {
-            Button btn = (Button)(i + 1);
-            if (inputManager.checkButton(btn, event) != EVENT_NONE) {
-                return {btn, event};
-            }
-        }
-        return {BTN_NONE, EVENT_NONE};
+        return inputManager.next();
     }
 private:
     InputManager& inputManager;
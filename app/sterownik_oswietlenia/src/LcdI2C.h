@@ -0,0 +1,183 @@
+#ifndef LCD_I2C_H
+#define LCD_I2C_H
+
+#include <Arduino.h>
+#include "I2cBus.h"
+#include "Constants.h"
+
+// HD44780 in 4-bit mode behind a PCF8574 backpack
+// (LiquidCrystal_I2C wiring: P0 = RS, P1 = RW, P2 = EN, P3 = backlight, P4-P7 = D4-D7).
+// A byte is 4 expander writes - nibble with EN high, then EN low - and consecutive bytes are
+// packed into one TWI transaction until the Wire buffer is full, instead of one transaction
+// and a 50us delay per expander write. At 400 kHz the two expander bytes between a character's
+// last EN fall and the next character's first take 45us, longer than the 37us write time, so
+// no explicit delays are needed between characters.
+class LcdI2C {
+public:
+    LcdI2C(uint8_t addr, uint8_t cols, uint8_t rows) : address(addr), cols(cols), rows(rows) {}
+
+    unsigned long bytesOnBus = 0;       // bytes clocked out, address byte of each transaction included
+    unsigned long lastWriteMicros = 0;  // duration of the last write() call
+
+    // Cold start: the HD44780 needs >40ms after Vcc rises before it accepts the init sequence
+    void begin() {
+        delay(50);
+        init();
+    }
+
+    void init() {
+        I2cBus::begin();
+
+        // Three 8-bit function sets resync the nibble phase from any state, then switch to 4-bit
+        writeInitNibble(0x03); delayMicroseconds(4500);
+        writeInitNibble(0x03); delayMicroseconds(150);
+        writeInitNibble(0x03); delayMicroseconds(150);
+        writeInitNibble(0x02); delayMicroseconds(150);
+
+        configure();
+        clear();
+    }
+
+    // Same nibble-phase recovery and mode setup as init(), without the power-on waits and
+    // without clearing DDRAM (~2.5ms). If the phase was off by one, the first 0x3 completes a
+    // stray command - at worst 'return home' (1.52ms), hence the one longer wait.
+    void resync() {
+        writeInitNibble(0x03); delayMicroseconds(2000);
+        writeInitNibble(0x03); delayMicroseconds(100);
+        writeInitNibble(0x03); delayMicroseconds(100);
+        writeInitNibble(0x02); delayMicroseconds(100);
+        configure();
+    }
+
+    // Read DDRAM back through the expander (RW = 1, D4-D7 released high). False if the bus
+    // read fails. Backpacks with RW tied to GND read back 0xFF and never match.
+    bool readBack(uint8_t col, uint8_t row, char* buf, uint8_t len) {
+        setCursor(col, row);
+        bool ok = true;
+        for (uint8_t i = 0; i < len && ok; i++) {
+            uint8_t hi = 0, lo = 0;
+            ok = readNibble(hi) && readNibble(lo);
+            buf[i] = (hi & 0xF0) | (lo >> 4);
+        }
+        beginBatch();
+        put(backlightBit); // back to write mode
+        endBatch();
+        return ok;
+    }
+
+    void setBacklight(bool on) {
+        backlightBit = on ? BIT_BACKLIGHT : 0;
+        beginBatch();
+        put(backlightBit);
+        endBatch();
+    }
+
+    void clear() {
+        command(0x01);
+        delayMicroseconds(2000); // clear takes 1.52ms
+    }
+
+    void setCursor(uint8_t col, uint8_t row) {
+        command(0x80 | ddramAddress(col, row));
+    }
+
+    // Cursor move + text run in one transaction; the HD44780 auto-increments across the run
+    void write(uint8_t col, uint8_t row, const char* text, uint8_t len) {
+        unsigned long start = micros();
+        beginBatch();
+        writeByte(0x80 | ddramAddress(col, row), 0);
+        put(BIT_RS | backlightBit); // RS settles before the first EN edge
+        for (uint8_t i = 0; i < len; i++) {
+            writeByte((uint8_t)text[i], BIT_RS);
+        }
+        endBatch();
+        lastWriteMicros = micros() - start;
+    }
+
+    void command(uint8_t value) {
+        beginBatch();
+        writeByte(value, 0);
+        endBatch();
+    }
+
+private:
+    static const uint8_t BIT_RS        = 0x01;
+    static const uint8_t BIT_RW        = 0x02;
+    static const uint8_t BIT_EN        = 0x04;
+    static const uint8_t BIT_BACKLIGHT = 0x08;
+    static const uint8_t BYTES_PER_WRITE = 4;
+
+    uint8_t address;
+    uint8_t cols;
+    uint8_t rows;
+    uint8_t backlightBit = BIT_BACKLIGHT;
+    uint8_t batched = 0;  // expander bytes in the open transaction
+
+    uint8_t ddramAddress(uint8_t col, uint8_t row) const {
+        static const uint8_t ROW_OFFSETS[4] = {0x00, 0x40, 0x14, 0x54};
+        if (row >= rows) row = rows - 1;
+        if (col >= cols) col = cols - 1;
+        return col + ROW_OFFSETS[row];
+    }
+
+    void beginBatch() {
+        Wire.beginTransmission(address);
+        batched = 0;
+    }
+
+    void endBatch() {
+        I2cBus::endTransmission();
+        bytesOnBus += batched + 1;
+        batched = 0;
+    }
+
+    void put(uint8_t b) {
+        Wire.write(b);
+        batched++;
+    }
+
+    void writeByte(uint8_t value, uint8_t mode) {
+        // Never split a byte's nibbles across transactions; roll over to a new one when full
+        if (batched + BYTES_PER_WRITE > BUFFER_LENGTH) {
+            endBatch();
+            beginBatch();
+        }
+        uint8_t hi = (value & 0xF0) | mode | backlightBit;
+        uint8_t lo = (value << 4) | mode | backlightBit;
+        put(hi | BIT_EN);
+        put(hi);
+        put(lo | BIT_EN);
+        put(lo);
+    }
+
+    void configure() {
+        command(0x28);  // function set: 4-bit, 2 lines, 5x8
+        command(0x0C);  // display on, cursor off, blink off
+        command(0x06);  // entry mode: increment, no shift
+    }
+
+    bool readNibble(uint8_t& value) {
+        uint8_t idle = 0xF0 | BIT_RW | BIT_RS | backlightBit;
+        beginBatch();
+        put(idle);
+        put(idle | BIT_EN);
+        endBatch();
+        bool ok = I2cBus::requestFrom(address, 1);
+        value = ok ? Wire.read() : 0;
+        bytesOnBus += 2;
+        beginBatch();
+        put(idle);
+        endBatch();
+        return ok;
+    }
+
+    void writeInitNibble(uint8_t nibble) {
+        uint8_t b = (nibble << 4) | backlightBit;
+        beginBatch();
+        put(b | BIT_EN);
+        put(b);
+        endBatch();
+    }
+};
+
+#endif // LCD_I2C_H
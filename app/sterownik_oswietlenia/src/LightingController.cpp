@@ -1,9 +1,21 @@
 #include "LightingController.h"
 #include "TimeController.h"
+#include "FeedbackAdc.h"
+#include "OutputRegulator.h"
+#include "EmiWindow.h"
 #include <Arduino.h>
 
-const unsigned long TRANSITION_STABILIZE_TIMEOUT = 60000UL; // 60s fallback - system always floats on PWM, window logic is primary
-const float STABILIZATION_THRESHOLD = 2.0f;
+const unsigned long TRANSITION_STABILIZE_TIMEOUT = 60000UL; // 60s fallback - system always floats on PWM, settle detection is primary
+
+// Self-test mask order: a 3-bit Gray code, so each mask is one relay away from the one before
+// and only that ballast's dwell has to run out
+static const uint8_t SELF_TEST_MASKS[] = {1, 3, 2, 6, 7, 5, 4};
+static const uint8_t SELF_TEST_MASK_COUNT = sizeof(SELF_TEST_MASKS);
+static_assert(SELF_TEST_MASK_COUNT == BallastModel::MASKS, "the self-test covers every modelled mask");
+// Output levels per mask: the first settles the new load, the rest are the measured steps -
+// up and down, of several sizes, five distinct points for the linearity fit. Every switch puts a
+// cold tube on the line, so all of them sit at or above MIN_COLD_PER_TUBE_POWER.
+static const uint8_t SELF_TEST_LEVEL_PERCENT[SELF_TEST_LEVELS] = {60, 95, 75, 50, 85};
 
 LightingController::LightingController() {
     currentBallastMask = 0;
@@ -12,37 +24,77 @@ LightingController::LightingController() {
 void LightingController::begin(TimeController& tc) {
     timeCtrl = &tc;
     pinMode(VOLTAGE_OUTPUT_PIN, OUTPUT);
-    pinMode(SWITCH_TRANSFORMER_PIN, OUTPUT);
-    pinMode(SWITCH_BALLAST_1_PIN, OUTPUT);
-    pinMode(SWITCH_BALLAST_2_PIN, OUTPUT);
-    pinMode(SWITCH_BALLAST_3_PIN, OUTPUT);
-
-    digitalWrite(SWITCH_TRANSFORMER_PIN, HIGH);
-    digitalWrite(SWITCH_BALLAST_1_PIN, HIGH);
-    digitalWrite(SWITCH_BALLAST_2_PIN, HIGH);
-    digitalWrite(SWITCH_BALLAST_3_PIN, HIGH);
+    Relays::begin();
     analogWrite(VOLTAGE_OUTPUT_PIN, ANALOG_WRITE_RESOLUTION);
+    ffMap.load();
+    model.load();
+    adcCal.load();
+    applyFeedbackScale();
+    FeedbackAdc::begin();
+    OutputRegulator::begin();
+
+    Checkpoint cp;
+    if (tc.getCheckpoint(cp)) {
+        restoreCheckpoint(cp, tc.nowUTC());
+    }
+}
+
+void LightingController::restoreCheckpoint(const Checkpoint& cp, time_t nowUtc) {
+    applyRotation(cp.rotationDay);
+
+    // Only a short outage (watchdog/brown-out reset) resumes the lit state; otherwise boot normally.
+    // The checkpoint may be up to CHECKPOINT_INTERVAL_MS old when the reset hits.
+    long downtime = (long)(nowUtc - cp.utc);
+    if (cp.ballastMask == 0 || cp.ballastMask > (BALLAST_1 | BALLAST_2 | BALLAST_3)) return;
+    if (downtime < -CHECKPOINT_CLOCK_TOLERANCE_S || downtime > (long)CHECKPOINT_RESUME_WINDOW_S) return;
+
+    // The lights were on a moment ago: skip the soft-start ramp, but relight through the normal
+    // path - transformer and its warm-up first, then one ballast at a time with the cold-start
+    // minimum - rather than closing every relay at once into the transformer's inrush
+    firstUpdate = false;
+    resumedFromCheckpoint = true;
+}
+
+void LightingController::updateCheckpoint() {
+    if (!timeCtrl) return;
+    if (currentBallastMask == checkpointMask && millis() - lastCheckpointMs < CHECKPOINT_INTERVAL_MS) return;
+
+    Checkpoint cp;
+    cp.ballastMask = currentBallastMask;
+    cp.rotationDay = lastRotationDay;
+    if (timeCtrl->saveCheckpoint(cp)) {
+        checkpointMask = currentBallastMask;
+        lastCheckpointMs = millis();
+    }
 }
 
 void LightingController::update(time_t now, const Settings& settings) {
+    trackSupply();
+
+    if (selfTestState != SelfTestState::IDLE) {
+        runSelfTest();
+        updateCheckpoint();
+        return;
+    }
+
     if (overrideEnabled) {
         isFault = false;
-        faultCheckTimer = 0;
+        faultDetector.reset();
         softStartActive = false;
         transitionState = TransitionState::IDLE;
         mainState = MainState::EVENING_BLOCK; // prevent regulateOutputVoltage from zeroing target
         currentPhaseName = "Override";
+        plannedMask = 0;
         scheduleTargetBallastMask = (overridePowerPercent > 0) ? (BALLAST_1 | BALLAST_2 | BALLAST_3) : 0;
         scheduleTargetPower = (float)overridePowerPercent;
         targetPowerPercent = scheduleTargetPower;
         manageTransformer();
         if (transformerOn) setBallasts(scheduleTargetBallastMask);
         regulateOutputVoltage();
+        updateCheckpoint();
         return;
     }
 
-    detectFaults();
-
     if (isFault) {
         scheduleTargetPower = 0;
         scheduleTargetBallastMask = 0;
@@ -81,9 +133,15 @@ void LightingController::update(time_t now, const Settings& settings) {
         }
     }
 
+    if (isFault) {
+        plannedMask = 0;
+    } else {
+        planTransitions(cachedNowSeconds);
+    }
     manageTransformer();
     manageTransitions();
     regulateOutputVoltage();
+    updateCheckpoint();
 }
 
 void LightingController::triggerSoftStart() {
@@ -92,7 +150,9 @@ void LightingController::triggerSoftStart() {
 }
 
 bool LightingController::isTransformerOn() const { return transformerOn; }
+uint16_t LightingController::getRelayCycles(uint8_t relay) const { return relay < 4 ? Relays::cycles[relay] : 0; }
 bool LightingController::isSystemInFault() const { return isFault; }
+const FaultDetector& LightingController::getFaultDetector() const { return faultDetector; }
 
 float LightingController::getCurrentPowerPercent() const { return currentPowerPercent; }
 const char* LightingController::getCurrentPhaseName() const { return currentPhaseName; }
@@ -136,27 +196,18 @@ long LightingController::getSecondsToNextPhase() const {
     }
 }
 
-void LightingController::detectFaults() {
-    if (scheduleTargetPower > 5.0f && getFeedbackVoltagePercent() < 1.0f) {
-        if (faultCheckTimer == 0) {
-            faultCheckTimer = millis();
-        }
-        if (millis() - faultCheckTimer > 5000) {
-            isFault = true;
-        }
-    } else if (!isFault) {
-        faultCheckTimer = 0;
-    }
-}
-
 void LightingController::updateDailyRotation(time_t now) {
     tmElements_t tm;
     breakTime(now, tm);
     int today = tm.Day + tm.Month * 31;
     if (today == lastRotationDay) return;
-    lastRotationDay = today;
+    applyRotation(today);
+}
 
-    if (today % 2 == 0) {
+void LightingController::applyRotation(int day) {
+    lastRotationDay = day;
+
+    if (day % 2 == 0) {
         primaryPair = BALLAST_1;
         secondaryPair = BALLAST_2;
     } else {
@@ -236,60 +287,141 @@ void LightingController::processActiveBlock(long blockStartSeconds, long blockDu
                                             long nowSeconds, bool isMorning) {
     if (blockDuration <= 0) return;
     float blockProgress = (float)(nowSeconds - blockStartSeconds) / blockDuration;
+    const SchedulePhase* phase = findPhase(phases, phaseCount, blockProgress);
+    if (!phase) return;
+
+    currentPhaseName = phase->name;
+    float scheduleTotalSystemPower = phasePower(*phase, blockProgress);
+    bool warm = tubesAreWarm();
+    scheduleTargetBallastMask = maskFor(scheduleTotalSystemPower, isMorning, warm);
+    bool adding = (scheduleTargetBallastMask & ~currentBallastMask) != 0; // new tubes start cold
+    scheduleTargetPower = perTubePower(scheduleTotalSystemPower, scheduleTargetBallastMask, warm && !adding);
+    phaseEndSeconds = blockStartSeconds + (long)(phase->endPercent * blockDuration);
+}
 
+const SchedulePhase* LightingController::findPhase(const SchedulePhase* phases, int phaseCount,
+                                                   float blockProgress) {
     for (int i = 0; i < phaseCount; i++) {
-        const SchedulePhase& phase = phases[i];
-        if (blockProgress >= phase.startPercent && blockProgress <= phase.endPercent) {
-            currentPhaseName = phase.name;
+        if (blockProgress >= phases[i].startPercent && blockProgress <= phases[i].endPercent) {
+            return &phases[i];
+        }
+    }
+    return nullptr;
+}
 
-            float scheduleTotalSystemPower;
-            if (phase.type == PhaseType::HOLD) {
-                scheduleTotalSystemPower = phase.startPower;
-            } else {
-                float phaseDurationPercent = phase.endPercent - phase.startPercent;
-                float progress = (phaseDurationPercent <= 0) ? 1.0f : (blockProgress - phase.startPercent) / phaseDurationPercent;
-                float rampProgress = progress;
+float LightingController::phasePower(const SchedulePhase& phase, float blockProgress) {
+    if (phase.type == PhaseType::HOLD) return phase.startPower;
 
-                if (phase.type == PhaseType::RAMP_QUAD_IN) { rampProgress = progress * progress; }
-                else if (phase.type == PhaseType::RAMP_QUAD_OUT) { rampProgress = 1.0f - (1.0f - progress) * (1.0f - progress); }
-                scheduleTotalSystemPower = phase.startPower + (phase.endPower - phase.startPower) * rampProgress;
-            }
+    float phaseDurationPercent = phase.endPercent - phase.startPercent;
+    float progress = (phaseDurationPercent <= 0) ? 1.0f : (blockProgress - phase.startPercent) / phaseDurationPercent;
+    float rampProgress = progress;
 
-            scheduleTargetBallastMask = selectOptimalMask(scheduleTotalSystemPower, isMorning);
-
-            // Warm-hold: if current tubes are warm and can sustain warm MIN,
-            // keep them even if selectOptimalMask suggests fewer (smoother ramp-down)
-            bool warm = tubesAreWarm();
-            int currentTubes = countTubesInMask(currentBallastMask);
-            int targetTubes = countTubesInMask(scheduleTargetBallastMask);
-            if (warm && currentTubes > 0 && targetTubes < currentTubes) {
-                float perTubeWithCurrent = (scheduleTotalSystemPower * 5.0f) / currentTubes;
-                if (perTubeWithCurrent >= MIN_WARM_PER_TUBE_POWER) {
-                    scheduleTargetBallastMask = currentBallastMask;
-                }
-            }
+    if (phase.type == PhaseType::RAMP_QUAD_IN) { rampProgress = progress * progress; }
+    else if (phase.type == PhaseType::RAMP_QUAD_OUT) { rampProgress = 1.0f - (1.0f - progress) * (1.0f - progress); }
+    return phase.startPower + (phase.endPower - phase.startPower) * rampProgress;
+}
 
-            int tubesInMask = countTubesInMask(scheduleTargetBallastMask);
-            if (tubesInMask > 0) {
-                float perTubePower = (scheduleTotalSystemPower * 5.0f) / tubesInMask;
-                scheduleTargetPower = constrain(perTubePower, 0.0f, 100.0f);
-                if (scheduleTotalSystemPower > 0.0f) {
-                    float activeMin = warm ? MIN_WARM_PER_TUBE_POWER : MIN_COLD_PER_TUBE_POWER;
-                    scheduleTargetPower = max(scheduleTargetPower, activeMin);
-                }
-            } else {
-                scheduleTargetPower = 0;
-            }
+// Total system power the schedule asks for at 'seconds' (runScheduler's day frame, any time
+// of the current day) - the same curve runScheduler follows live, for looking ahead
+float LightingController::systemPowerAt(long seconds, bool& isMorning) const {
+    long totalDuration = cachedStopSeconds - cachedStartSeconds;
+    isMorning = false;
+    if (totalDuration <= 0 || seconds < cachedStartSeconds || seconds >= cachedStopSeconds) return 0.0f;
+
+    long siestaStartSeconds = cachedStartSeconds + totalDuration * SIESTA_START_PERCENT_OF_DAY;
+    long siestaEndSeconds = cachedStartSeconds + totalDuration * SIESTA_END_PERCENT_OF_DAY;
+    if (seconds >= siestaStartSeconds && seconds < siestaEndSeconds) return 0.0f;
+
+    isMorning = seconds < siestaStartSeconds;
+    long blockStart = isMorning ? cachedStartSeconds : siestaEndSeconds;
+    long blockDuration = isMorning ? siestaStartSeconds - cachedStartSeconds : cachedStopSeconds - siestaEndSeconds;
+    if (blockDuration <= 0) return 0.0f;
+    float blockProgress = (float)(seconds - blockStart) / blockDuration;
+    const SchedulePhase* phase = isMorning
+        ? findPhase(PRO_SCHEDULE_MORNING, PRO_SCHEDULE_MORNING_PHASES_COUNT, blockProgress)
+        : findPhase(PRO_SCHEDULE_EVENING, PRO_SCHEDULE_EVENING_PHASES_COUNT, blockProgress);
+    return phase ? phasePower(*phase, blockProgress) : 0.0f;
+}
+
+uint8_t LightingController::maskFor(float systemPower, bool isMorning, bool warm) const {
+    uint8_t mask = selectOptimalMask(systemPower, isMorning);
+
+    // Hysteresis: a tube-count threshold has to be cleared by MASK_HYSTERESIS_POWER before the
+    // mask leaves the current one, so power hovering at 30% or 50% cannot cycle the relays
+    int currentTubes = countTubesInMask(currentBallastMask);
+    if (currentTubes > 0 && systemPower > 0.0f) {
+        int tubes = countTubesInMask(mask);
+        if ((tubes > currentTubes &&
+                countTubesInMask(selectOptimalMask(systemPower - MASK_HYSTERESIS_POWER, isMorning)) <= currentTubes) ||
+            (tubes < currentTubes &&
+                countTubesInMask(selectOptimalMask(systemPower + MASK_HYSTERESIS_POWER, isMorning)) >= currentTubes)) {
+            mask = currentBallastMask;
+        }
+    }
+
+    // Warm-hold: if current tubes are warm and can sustain warm MIN,
+    // keep them even if selectOptimalMask suggests fewer (smoother ramp-down)
+    if (warm && currentTubes > 0 && countTubesInMask(mask) < currentTubes) {
+        float perTubeWithCurrent = (systemPower * 5.0f) / currentTubes;
+        if (perTubeWithCurrent >= MIN_WARM_PER_TUBE_POWER) {
+            mask = currentBallastMask;
+        }
+    }
+    return mask;
+}
+
+float LightingController::perTubePower(float systemPower, uint8_t mask, bool warm) const {
+    int tubesInMask = countTubesInMask(mask);
+    if (tubesInMask == 0) return 0.0f;
+
+    float perTubePower = constrain((systemPower * 5.0f) / tubesInMask, 0.0f, 100.0f);
+    if (systemPower > 0.0f) {
+        float activeMin = warm ? MIN_WARM_PER_TUBE_POWER : MIN_COLD_PER_TUBE_POWER;
+        perTubePower = max(perTubePower, activeMin);
+    }
+    return perTubePower;
+}
 
-            phaseEndSeconds = blockStartSeconds + (long)(phase.endPercent * blockDuration);
-            return;
+// Look ahead along the day's power curve for the next change between two lit masks, so the
+// pre-dim and its settling run before the boundary instead of after it. Once per schedule
+// second; PLAN_LEAD_S evaluations of the curve.
+void LightingController::planTransitions(long nowSeconds) {
+    if (nowSeconds == lastPlanSeconds) return;
+    lastPlanSeconds = nowSeconds;
+    plannedMask = 0;
+    if (currentBallastMask == 0 || softStartActive) return;
+
+    bool warm = tubesAreWarm();
+    for (long t = nowSeconds + 1; t <= nowSeconds + (long)PLAN_LEAD_S; t++) {
+        bool isMorning;
+        float power = systemPowerAt(t, isMorning);
+        uint8_t mask = maskFor(power, isMorning, warm);
+        if (mask == currentBallastMask) continue;
+        if (mask != 0) {
+            bool adding = (mask & ~currentBallastMask) != 0; // new tubes start cold
+            plannedMask = mask;
+            plannedSwitchSeconds = t;
+            plannedPower = perTubePower(power, mask, warm && !adding);
         }
+        return;
     }
 }
 
+bool LightingController::planDue() const {
+    return plannedMask != 0 && plannedSwitchSeconds - cachedNowSeconds <= (long)PLAN_LEAD_S;
+}
+
+// Planned transition before its boundary: ramp from where the schedule was to the post-switch
+// level, arriving PLAN_SETTLE_S early so the settle check has passed when the boundary comes
+float LightingController::preDimTarget() const {
+    unsigned long elapsed = millis() - transitionStartTime;
+    if (elapsed >= preDimMs) return plannedPower;
+    return preDimFrom + (plannedPower - preDimFrom) * ((float)elapsed / preDimMs);
+}
+
 void LightingController::manageTransitions() {
     if (transitionState == TransitionState::IDLE) {
-        if (currentBallastMask != scheduleTargetBallastMask) {
+        if (currentBallastMask != scheduleTargetBallastMask || planDue()) {
             transitionState = TransitionState::START_TRANSITION;
         } else {
             targetPowerPercent = scheduleTargetPower;
@@ -301,19 +433,46 @@ void LightingController::manageTransitions() {
 
     switch(transitionState) {
         case TransitionState::START_TRANSITION:
+            // Ahead of a planned boundary the schedule still wants the current mask
+            plannedTransition = currentBallastMask == scheduleTargetBallastMask;
+            boundarySeconds = plannedTransition ? plannedSwitchSeconds : cachedNowSeconds;
+            if (plannedTransition) {
+                long rampSeconds = plannedSwitchSeconds - cachedNowSeconds - (long)PLAN_SETTLE_S;
+                preDimFrom = scheduleTargetPower;
+                preDimMs = rampSeconds > 0 ? rampSeconds * 1000UL : 0;
+            }
             targetPowerPercent = scheduleTargetPower;
             transitionStartTime = millis();
-            stabilityWindowStart = 0;
+            stepStartTime = millis();
+            settle.reset();
             transitionState = TransitionState::WAIT_FOR_DIM;
             break;
 
         case TransitionState::WAIT_FOR_DIM:
+            if (plannedTransition && currentBallastMask == scheduleTargetBallastMask) {
+                // Boundary not reached yet: pre-dim towards it, or drop out if the plan went away
+                // (settings changed, tubes cooled)
+                if (!planDue()) {
+                    transitionState = TransitionState::IDLE;
+                    break;
+                }
+                targetPowerPercent = preDimTarget();
+                break;
+            }
             // Track schedule changes: target may shift during slow ramp (schedule is a live ramp)
             targetPowerPercent = scheduleTargetPower;
 
+            // Lights out at a block end: nothing to dim towards - the floor output never reads
+            // as settled on a 0% target, so this used to sit out the full timeout
+            if (scheduleTargetBallastMask == 0) {
+                lastDimSettleMs = 0;
+                transitionState = TransitionState::SWITCH_BALLAST;
+                break;
+            }
+
             // Block while 1-10V circuit is warming up: feedback unreliable, output not yet driven
             if (transformerOn && (millis() - transformerOnTime < TRANSFORMER_WARMUP_MS)) {
-                stabilityWindowStart = 0;
+                settle.reset();
                 transitionStartTime = millis(); // keep timeout reset while blocked
                 break;
             }
@@ -321,30 +480,29 @@ void LightingController::manageTransitions() {
             // New tubes need reliable arc ignition - warm MIN is insufficient.
             if ((scheduleTargetBallastMask & ~currentBallastMask) != 0 &&
                     targetPowerPercent < MIN_COLD_PER_TUBE_POWER) {
-                stabilityWindowStart = 0;
+                settle.reset();
                 transitionStartTime = millis(); // keep timeout reset while blocked
                 break;
             }
 
-            if (abs(currentPowerPercent - targetPowerPercent) < STABILIZATION_THRESHOLD) {
-                if (stabilityWindowStart == 0) stabilityWindowStart = millis();
-                if (millis() - stabilityWindowStart >= STABILITY_WINDOW_MS) {
-                    stabilityWindowStart = 0;
-                    transitionState = TransitionState::SWITCH_BALLAST;
-                }
-            } else {
-                stabilityWindowStart = 0;
-            }
-            if (elapsed > TRANSITION_STABILIZE_TIMEOUT) {
-                stabilityWindowStart = 0;
+            if (waitForSettle(elapsed, lastDimSettleMs)) {
                 transitionState = TransitionState::SWITCH_BALLAST;
             }
             break;
 
         case TransitionState::SWITCH_BALLAST: {
-            uint8_t to_add = scheduleTargetBallastMask & ~currentBallastMask;
-            uint8_t to_remove = currentBallastMask & ~scheduleTargetBallastMask;
+            // Only ballasts past their minimum dwell may change; wait here for the others
+            targetPowerPercent = scheduleTargetPower;
+            uint8_t allowed = isFault ? scheduleTargetBallastMask : dwellLimited(scheduleTargetBallastMask);
+            uint8_t to_add = allowed & ~currentBallastMask;
+            uint8_t to_remove = currentBallastMask & ~allowed;
             uint8_t nextMask = currentBallastMask;
+            if (!to_add && !to_remove) {
+                if (scheduleTargetBallastMask == currentBallastMask) {
+                    transitionState = TransitionState::FINISH_TRANSITION;
+                }
+                break;
+            }
 
             if (to_add) {
                 uint8_t add = (to_add & BALLAST_1) ? BALLAST_1 : ((to_add & BALLAST_2) ? BALLAST_2 : BALLAST_3);
@@ -354,9 +512,10 @@ void LightingController::manageTransitions() {
                 nextMask &= ~remove;
             }
 
+            // Feedback was stabilized at scheduleTargetPower in WAIT_FOR_DIM; setBallasts()
+            // re-seeds the output for the new load so it stays there - no lumen compensation needed.
             setBallasts(nextMask);
-            // New ballasts start at current outputPercent, which equals scheduleTargetPower
-            // we stabilized at in WAIT_FOR_DIM - no lumen compensation needed.
+            switchLagSeconds = cachedNowSeconds - boundarySeconds;
             transitionState = TransitionState::RAMP_UP;
             transitionStartTime = millis();
             lastBallastSwitchTime = millis();
@@ -367,24 +526,20 @@ void LightingController::manageTransitions() {
             targetPowerPercent = scheduleTargetPower;
             transitionState = TransitionState::WAIT_FOR_BRIGHT;
             transitionStartTime = millis();
+            settle.reset();
             break;
 
         case TransitionState::WAIT_FOR_BRIGHT:
             // Track schedule changes during stabilization wait
             targetPowerPercent = scheduleTargetPower;
-            if (abs(currentPowerPercent - targetPowerPercent) < STABILIZATION_THRESHOLD) {
-                if (stabilityWindowStart == 0) stabilityWindowStart = millis();
-                if (millis() - stabilityWindowStart >= STABILITY_WINDOW_MS) {
-                    stabilityWindowStart = 0;
-                    transitionState = TransitionState::FINISH_TRANSITION;
-                }
-            } else {
-                stabilityWindowStart = 0;
-            }
-            if (elapsed > TRANSITION_STABILIZE_TIMEOUT) {
-                stabilityWindowStart = 0;
-                transitionState = TransitionState::FINISH_TRANSITION;
+            // Lights out: nothing lit to settle (see WAIT_FOR_DIM)
+            if (currentBallastMask == 0) {
+                lastBrightSettleMs = 0;
+            } else if (!waitForSettle(elapsed, lastBrightSettleMs)) {
+                break;
             }
+            lastStepMs = millis() - stepStartTime;
+            transitionState = TransitionState::FINISH_TRANSITION;
             break;
 
         case TransitionState::FINISH_TRANSITION:
@@ -401,13 +556,48 @@ void LightingController::manageTransitions() {
     }
 }
 
+// Settled per SettleDetector (fed in observeFeedback()), or the fallback timeout.
+// 'latency' gets how long the wait took.
+bool LightingController::waitForSettle(unsigned long elapsed, unsigned long& latency) {
+    bool done = !EmiWindow::active() && settle.settled(model.tauMs(currentBallastMask));
+    if (!done && elapsed > TRANSITION_STABILIZE_TIMEOUT) {
+        done = true;
+        settleTimeouts++;
+    }
+    if (done) latency = elapsed;
+    return done;
+}
+
+// A ballast keeps its state until its minimum on/off dwell has run out
+uint8_t LightingController::dwellLimited(uint8_t mask) const {
+    uint8_t changing = (mask ^ currentBallastMask) & dwellArmed;
+    for (uint8_t i = 0; i < 3; i++) {
+        uint8_t bit = 1 << i; // BALLAST_1..3
+        if (!(changing & bit)) continue;
+        unsigned long minDwell = (currentBallastMask & bit) ? BALLAST_MIN_ON_MS : BALLAST_MIN_OFF_MS;
+        if (millis() - ballastChangeMs[i] < minDwell) mask ^= bit;
+    }
+    return mask;
+}
+
 void LightingController::setBallasts(uint8_t mask) {
+    if (!isFault) mask = dwellLimited(mask); // a fault shuts down regardless
     if (currentBallastMask == mask) return;
-    digitalWrite(SWITCH_BALLAST_1_PIN, (mask & BALLAST_1) ? LOW : HIGH);
-    digitalWrite(SWITCH_BALLAST_2_PIN, (mask & BALLAST_2) ? LOW : HIGH);
-    digitalWrite(SWITCH_BALLAST_3_PIN, (mask & BALLAST_3) ? LOW : HIGH);
-    if (timeCtrl) timeCtrl->suppressReads(500);
+    EmiWindow::announce();
+    Relays::setBallasts(mask);
+    uint8_t changed = mask ^ currentBallastMask;
+    for (uint8_t i = 0; i < 3; i++) {
+        if (changed & (1 << i)) ballastChangeMs[i] = millis();
+    }
+    dwellArmed |= changed;
     currentBallastMask = mask;
+
+    // The new load moves the feedback at once; start from the output the new mask's model
+    // expects for the current target instead of slewing there from the old operating point
+    bool warmingUp = millis() - transformerOnTime < TRANSFORMER_WARMUP_MS;
+    if (model.trained(mask) && transformerOn && !warmingUp && targetPowerPercent > 0) {
+        OutputRegulator::setOutputPercent(feedforwardFor(targetPowerPercent));
+    }
 }
 
 int LightingController::countTubesInMask(uint8_t mask) const {
@@ -419,9 +609,8 @@ int LightingController::countTubesInMask(uint8_t mask) const {
 }
 
 float LightingController::getFeedbackVoltagePercent() const {
-    float measuredVoltage = (analogRead(VOLTAGE_FEEDBACK_PIN) / (float)ANALOG_READ_RESOLUTION) * 5.0f * 2.0f;
-    float power = (measuredVoltage - 1.0f) * (100.0f / 9.0f);
-    return constrain(power, 0.0f, 100.0f);
+    // Converted from the ADC's mains-window mean by the regulator tick
+    return OutputRegulator::getFeedbackPercent();
 }
 
 void LightingController::manageTransformer() {
@@ -430,10 +619,10 @@ void LightingController::manageTransformer() {
     if (lightsNeeded) {
         cooldownActive = false;
         if (!transformerOn) {
-            digitalWrite(SWITCH_TRANSFORMER_PIN, LOW);
+            EmiWindow::announce();
+            Relays::setTransformer(true);
             transformerOn = true;
             transformerOnTime = millis();
-            relaySwitched = true;
         }
     } else {
         if (transformerOn && !cooldownActive) {
@@ -441,10 +630,10 @@ void LightingController::manageTransformer() {
             lightsOffTime = millis();
         }
         if (cooldownActive && (millis() - lightsOffTime >= FAN_COOLDOWN_MS)) {
-            digitalWrite(SWITCH_TRANSFORMER_PIN, HIGH);
+            EmiWindow::announce();
+            Relays::setTransformer(false);
             transformerOn = false;
             cooldownActive = false;
-            relaySwitched = true;
         }
     }
 }
@@ -456,15 +645,294 @@ void LightingController::regulateOutputVoltage() {
         targetPowerPercent = 0;
     }
 
-    if (transformerOn && (millis() - transformerOnTime < TRANSFORMER_WARMUP_MS)) {
+    // Hold the output while the 1-10V circuit warms up
+    bool hold = transformerOn && (millis() - transformerOnTime < TRANSFORMER_WARMUP_MS);
+    if (hold) {
         targetPowerPercent = 0;
+    }
+
+    // The step itself runs at REGULATOR_RATE_HZ in the Timer1 ISR, independent of loop() timing
+    OutputRegulator::set(targetPowerPercent, feedforwardFor(targetPowerPercent), hold);
+    observeFeedback(hold);
+    learnModels(hold);
+}
+
+// The current mask's own model once it has seen enough of it; the shared map until then
+float LightingController::feedforwardFor(float targetPercent) const {
+    if (model.trained(currentBallastMask)) return model.outputFor(currentBallastMask, targetPercent);
+    return ffMap.outputFor(targetPercent);
+}
+
+float LightingController::expectedFeedback(float outputPercent) const {
+    if (model.trained(currentBallastMask)) return model.feedbackFor(currentBallastMask, outputPercent);
+    return ffMap.feedbackFor(outputPercent);
+}
+
+// A settled operating point is a sample of the output -> feedback curve, whatever the target
+void LightingController::learnModels(bool hold) {
+    if (hold || !transformerOn || EmiWindow::active()) return;
+    if (abs(targetPowerPercent - currentPowerPercent) >= FF_LEARN_MAX_ERROR) return;
+    if (millis() - lastFfLearnMs < FF_LEARN_INTERVAL_MS) return;
+    lastFfLearnMs = millis();
+
+    float output = OutputRegulator::getOutputPercent();
+    ffMap.learn(output, currentPowerPercent);
+
+    // Spread the mask's samples along the output range rather than piling them on one point
+    if (currentBallastMask != 0 &&
+            (abs(output - lastModelSampleOutput) >= MODEL_SAMPLE_SPACING ||
+             millis() - lastModelSampleMs >= MODEL_SAMPLE_INTERVAL_MS)) {
+        model.learn(currentBallastMask, output, currentPowerPercent);
+        lastModelSampleOutput = output;
+        lastModelSampleMs = millis();
+    }
+
+    if (millis() - lastModelSaveMs >= FF_MAP_SAVE_INTERVAL_MS) {
+        ffMap.save();
+        model.save();
+        lastModelSaveMs = millis();
+    }
+}
+
+// Once per feedback window: settle tracking for transitions, residual fault detection, and the
+// mask's dynamics from window-to-window feedback while it is still moving towards the settled
+// value. Only consecutive windows count for the model - a gap (blackout, slow loop pass) breaks
+// the sequence.
+void LightingController::observeFeedback(bool hold) {
+    float feedback;
+    uint8_t window = OutputRegulator::readFeedback(feedback);
+    if (window == modelWindow) return;
+    bool consecutive = (uint8_t)(window - modelWindow) == 1;
+    modelWindow = window;
+
+    settle.sample(targetPowerPercent - feedback, model.tauMs(currentBallastMask));
+
+    bool usable = consecutive && !hold && transformerOn && !EmiWindow::active();
+
+    // The output held over the last window against what it produced. A wide drift allowance
+    // while only the shared map predicts the feedback still catches a dead circuit at once.
+    if (consecutive && transformerOn && currentBallastMask != 0 && !hold && !overrideEnabled &&
+            !EmiWindow::active()) {
+        float drift = model.trained(currentBallastMask) ? FAULT_CUSUM_DRIFT : FAULT_CUSUM_DRIFT_UNTRAINED;
+        if (faultDetector.sample(expectedFeedback(modelOutput), feedback, model.tauMs(currentBallastMask), drift)) {
+            isFault = true;
+        }
+    } else {
+        faultDetector.reset();
+    }
+    modelHistory = usable ? min(modelHistory + 1, 2) : 0;
+    float output = OutputRegulator::getOutputPercent();
+    float feedbackStep = feedback - modelFeedback;
+    if (modelHistory == 2 && model.trained(currentBallastMask)) {
+        model.learnDynamics(currentBallastMask, modelOutputStep, modelFeedbackStep, feedbackStep);
+    }
+    modelOutputStep = output - modelOutput;
+    modelFeedbackStep = feedbackStep;
+    modelOutput = output;
+    modelFeedback = feedback;
+}
+
+// A latched fault is left for the override to clear - the test does not run on a faulted line
+bool LightingController::startSelfTest() {
+    if (selfTestState != SelfTestState::IDLE || isFault) return false;
+    selfTestFirst = 0;
+    for (uint8_t i = 0; i < SELF_TEST_MASK_COUNT; i++) {
+        if (SELF_TEST_MASKS[i] == currentBallastMask) selfTestFirst = i; // no relay for the first mask
+    }
+    memset(selfTestResults, 0, sizeof(selfTestResults));
+    selfTestMasksDone = 0;
+    selfTestLastMask = 0;
+    faultDetector.reset();
+    softStartActive = false;
+    transitionState = TransitionState::IDLE;
+    plannedMask = 0;
+    currentPhaseName = "Self-test";
+    selfTestState = SelfTestState::SWITCH_MASK;
+    return true;
+}
+
+// Masks already finished keep their stored results; the scheduler takes over from here
+void LightingController::stopSelfTest() {
+    selfTestState = SelfTestState::IDLE;
+}
+
+bool LightingController::isSelfTestRunning() const { return selfTestState != SelfTestState::IDLE; }
+
+uint8_t LightingController::getSelfTestMask() const {
+    return SELF_TEST_MASKS[(selfTestFirst + selfTestMasksDone) % SELF_TEST_MASK_COUNT];
+}
+
+uint8_t LightingController::getSelfTestStep() const {
+    return selfTestState == SelfTestState::STEP ? selfTestLevel + 1 : 0;
+}
+
+// Cold tubes are kept above the arc ignition minimum, as the scheduler does
+float LightingController::selfTestLevelPercent(uint8_t level) const {
+    float floor = tubesAreWarm() ? MIN_WARM_PER_TUBE_POWER : MIN_COLD_PER_TUBE_POWER;
+    return max((float)SELF_TEST_LEVEL_PERCENT[level], floor);
+}
+
+// Outputs actually held, at least SELF_TEST_MIN_STEP apart from each other
+uint8_t LightingController::distinctSelfTestLevels() const {
+    uint8_t distinct = 0;
+    for (uint8_t i = 0; i < SELF_TEST_LEVELS; i++) {
+        bool repeated = false;
+        for (uint8_t j = 0; j < i; j++) {
+            if (abs(selfTestOutput[i] - selfTestOutput[j]) < SELF_TEST_MIN_STEP) repeated = true;
+        }
+        if (!repeated) distinct++;
+    }
+    return distinct;
+}
+
+// For each mask in turn: switch to it once its ballast's dwell allows, then hold the output
+// open-loop at each scripted level for SELF_TEST_DWELL_WINDOWS feedback windows and measure the
+// steps between them. Same relays, PWM and feedback path as regulation - only the PI is held.
+void LightingController::runSelfTest() {
+    uint8_t mask = getSelfTestMask();
+    float level = selfTestLevelPercent(selfTestLevel);
+    scheduleTargetBallastMask = mask;
+    scheduleTargetPower = level;
+    targetPowerPercent = level;
+    manageTransformer();
+    currentPowerPercent = getFeedbackVoltagePercent();
+    OutputRegulator::set(level, level, true);
+
+    float feedback;
+    uint8_t window = OutputRegulator::readFeedback(feedback);
+    bool newWindow = window != selfTestWindow;
+    selfTestWindow = window;
+
+    if (selfTestState == SelfTestState::SWITCH_MASK) {
+        bool warmingUp = millis() - transformerOnTime < TRANSFORMER_WARMUP_MS;
+        if (!transformerOn || warmingUp || dwellLimited(mask) != mask) return;
+        if (mask != currentBallastMask) {
+            setBallasts(mask);
+            lastBallastSwitchTime = millis();
+        }
+        selfTestLevel = 0;
+        selfTestRiseSum = 0.0f;
+        OutputRegulator::setOutputPercent(selfTestLevelPercent(0));
+        stepResponse.begin(feedback); // settles the new load; not measured
+        selfTestState = SelfTestState::STEP;
         return;
     }
 
-    float error = targetPowerPercent - currentPowerPercent;
-    float step = constrain(error * VOLTAGE_KP, -MAX_VOLTAGE_STEP, MAX_VOLTAGE_STEP);
-    outputPercent += step;
-    outputPercent = constrain(outputPercent, 0.0f, 100.0f);
-    int pwm = (int)(outputPercent * ANALOG_WRITE_RESOLUTION / 100.0f);
-    analogWrite(VOLTAGE_OUTPUT_PIN, ANALOG_WRITE_RESOLUTION - pwm);
+    if (!newWindow || EmiWindow::active()) return;
+    if (!stepResponse.sample(feedback)) return;
+
+    SelfTestResult& r = selfTestResults[mask - 1];
+    float output = OutputRegulator::getOutputPercent();
+    float error = stepResponse.settled - expectedFeedback(output);
+    if (abs(error) > abs(r.steadyError)) r.steadyError = error;
+    if (selfTestLevel > 0 && stepResponse.measurable()) {
+        selfTestRiseSum += stepResponse.riseMs();
+        r.overshoot = max(r.overshoot, stepResponse.overshootPercent());
+        r.steps++;
+    }
+    selfTestOutput[selfTestLevel] = output;
+    selfTestFeedback[selfTestLevel] = stepResponse.settled;
+
+    if (++selfTestLevel < SELF_TEST_LEVELS) {
+        OutputRegulator::setOutputPercent(selfTestLevelPercent(selfTestLevel));
+        stepResponse.begin(stepResponse.settled);
+    } else {
+        finishSelfTestMask(mask);
+    }
+}
+
+void LightingController::finishSelfTestMask(uint8_t mask) {
+    SelfTestResult& r = selfTestResults[mask - 1];
+    float tauMs = 0.0f;
+    if (r.steps > 0) {
+        r.riseMs = (uint16_t)(selfTestRiseSum / r.steps + 0.5f);
+        tauMs = r.riseMs / log(9.0f); // first order: 10-90% rise = tau * ln 9
+    }
+    if (distinctSelfTestLevels() < SELF_TEST_LEVELS) {
+        r.gain = -1.0f; // a level got clamped: too few points to fit, keep what the mask has
+    } else {
+        r.gain = model.calibrate(mask, selfTestOutput, selfTestFeedback, SELF_TEST_LEVELS, tauMs, r.linearity);
+    }
+    if (r.gain >= MODEL_MIN_GAIN && r.gain <= MODEL_MAX_GAIN) {
+        for (uint8_t i = 0; i < SELF_TEST_LEVELS; i++) ffMap.learn(selfTestOutput[i], selfTestFeedback[i]);
+    }
+
+    selfTestLastMask = mask;
+    if (++selfTestMasksDone < SELF_TEST_MASK_COUNT) {
+        selfTestState = SelfTestState::SWITCH_MASK;
+        return;
+    }
+    ffMap.save();
+    model.save();
+    lastModelSaveMs = millis();
+    selfTestState = SelfTestState::IDLE;
+}
+
+void LightingController::applyFeedbackScale() {
+    OutputRegulator::setFeedbackScale(adcCal.zeroCounts, adcCal.fullCounts, supplyRatio);
+}
+
+// Each new bandgap reading from the ADC ISR: the supply now against the one the calibration
+// counts are referred to - the first reading, when no calibration has stored one yet.
+// AVcc is the ADC reference, so the feedback counts scale with the supply ratio.
+void LightingController::trackSupply() {
+    uint8_t count = FeedbackAdc::bandgapCount();
+    if (count == lastBandgapCount) return;
+    lastBandgapCount = count;
+    float bandgap = FeedbackAdc::bandgapSum() / (float)BANDGAP_SAMPLES;
+    if (bandgap < BANDGAP_MIN_COUNTS || bandgap > BANDGAP_MAX_COUNTS) return;
+    if (supplyBandgap == 0.0f) {
+        supplyBandgap = bandgap;
+    } else {
+        supplyBandgap += SUPPLY_FILTER_RATE * (bandgap - supplyBandgap);
+    }
+    if (adcCal.bandgapCounts == 0.0f) adcCal.bandgapCounts = supplyBandgap;
+    supplyRatio = adcCal.bandgapCounts / supplyBandgap; // bandgap counts fall as the supply rises
+    applyFeedbackScale();
+}
+
+uint8_t LightingController::calibrateFeedback(float lineVolts) {
+    float counts = FeedbackAdc::average() * supplyRatio; // referred to the calibration supply
+    if (!calPointPending) {
+        calPointCounts = counts;
+        calPointVolts = lineVolts;
+        calPointPending = true;
+        return 1;
+    }
+    calPointPending = false;
+    AdcCalibration previous = adcCal;
+    if (!adcCal.fromPoints(calPointCounts, calPointVolts, counts, lineVolts)) return 0;
+    applyCalibration(previous);
+    return 2;
+}
+
+void LightingController::resetFeedbackCalibration() {
+    AdcCalibration previous = adcCal;
+    adcCal.setDefaults();
+    adcCal.bandgapCounts = previous.bandgapCounts;
+    calPointPending = false;
+    applyCalibration(previous);
+}
+
+// Every feedback % the models and the map hold moves to the new scale with the line itself,
+// so feedforward and fault detection carry on without relearning
+void LightingController::applyCalibration(const AdcCalibration& previous) {
+    float scale, shift;
+    adcCal.rescaleFrom(previous, scale, shift);
+    model.rescaleFeedback(scale, shift);
+    ffMap.rescaleFeedback(scale, shift);
+    faultDetector.reset();
+    adcCal.save();
+    ffMap.save();
+    model.save();
+    lastModelSaveMs = millis();
+    applyFeedbackScale();
+}
+
+const AdcCalibration& LightingController::getFeedbackCalibration() const { return adcCal; }
+float LightingController::getSupplyRatio() const { return supplyRatio; }
+
+float LightingController::getSupplyVolts() const {
+    if (supplyBandgap == 0.0f) return 0.0f;
+    return BANDGAP_NOMINAL_VOLTS * (ANALOG_READ_RESOLUTION + 1) / supplyBandgap;
 }
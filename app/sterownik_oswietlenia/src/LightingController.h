@@ -5,6 +5,14 @@
 #include "Constants.h"
 #include "Settings.h"
 #include "Schedule.h"
+#include "RelayBank.h"
+#include "Checkpoint.h"
+#include "FeedforwardMap.h"
+#include "BallastModel.h"
+#include "SettleDetector.h"
+#include "FaultDetector.h"
+#include "StepResponse.h"
+#include "AdcCalibration.h"
 
 class TimeController;
 
@@ -20,14 +28,55 @@ public:
     const char* getCurrentPhaseName() const;
     uint8_t     getActiveBallastMask() const;
     bool        isSystemInFault() const;
+    const FaultDetector& getFaultDetector() const; // CUSUM state, for diagnostics
     bool        isTransformerOn() const;
+    uint16_t    getRelayCycles(uint8_t relay) const; // 0 = transformer, 1-3 = B1-B3
     void        triggerSoftStart();
 
-    bool        relaySwitched = false;
+    // Maintenance self-test: scripted open-loop output steps on every ballast mask, results
+    // stored in the mask models and the feedforward map (runSelfTest)
+    bool        startSelfTest();          // false while a fault is latched (or already running)
+    void        stopSelfTest();
+    bool        isSelfTestRunning() const;
+    uint8_t     getSelfTestMask() const;  // mask under test
+    uint8_t     getSelfTestStep() const;  // level 1-SELF_TEST_LEVELS being held, 0 = waiting for its relay
+
+    struct SelfTestResult {
+        uint8_t  steps;       // steps measured; 0 = mask not tested
+        uint16_t riseMs;      // mean 10-90% rise
+        float    overshoot;   // largest, % of the step
+        float    steadyError; // largest settled feedback minus what the stored model/map predicted, %
+        float    linearity;   // largest settled deviation from the fitted line, %
+        float    gain;        // fitted feedback % per output %; out of range = fit rejected,
+                              // negative = too few distinct levels to fit
+    };
+    SelfTestResult selfTestResults[BallastModel::MASKS]; // by mask - 1
+    uint8_t        selfTestMasksDone = 0; // BallastModel::MASKS once the run completes
+    uint8_t        selfTestLastMask = 0;  // last mask finished
+
+    // Two-point feedback calibration: the 1-10V line voltage read off a meter, at two output
+    // levels at least ADC_CAL_MIN_SPAN_VOLTS apart. Returns the points held - 2 means applied
+    // and saved; 0 = rejected, start over.
+    uint8_t     calibrateFeedback(float lineVolts);
+    void        resetFeedbackCalibration();
+    const AdcCalibration& getFeedbackCalibration() const;
+    float       getSupplyRatio() const;  // supply now / supply the calibration is referred to
+    float       getSupplyVolts() const;  // from the nominal bandgap, so +-10%; 0 = not measured yet
+
     bool        overrideEnabled = false;
     uint8_t     overridePowerPercent = 0;
 
+    // Transition latency of the last ballast step, ms
+    unsigned long lastDimSettleMs = 0;     // WAIT_FOR_DIM unblocked -> settled
+    unsigned long lastBrightSettleMs = 0;  // relay switched -> settled
+    unsigned long lastStepMs = 0;          // START_TRANSITION -> FINISH_TRANSITION
+    uint16_t      settleTimeouts = 0;      // waits ended by the fallback timeout instead
+    long          switchLagSeconds = 0;    // relay switch time minus the schedule boundary it served
+    bool          resumedFromCheckpoint = false; // boot skipped the soft start (restoreCheckpoint)
+
 private:
+    typedef RelayBank<TransformerRelayPin, Ballast1RelayPin, Ballast2RelayPin, Ballast3RelayPin> Relays;
+
     enum class MainState {
         OFF,
         MORNING_BLOCK,
@@ -48,6 +97,20 @@ private:
     };
     TransitionState transitionState = TransitionState::IDLE;
 
+    enum class SelfTestState {
+        IDLE,
+        SWITCH_MASK,
+        STEP
+    };
+    SelfTestState selfTestState = SelfTestState::IDLE;
+    uint8_t       selfTestFirst = 0;   // position in the mask sequence the run started at
+    uint8_t       selfTestLevel = 0;   // level being held
+    uint8_t       selfTestWindow = 0;  // last feedback window sampled
+    StepResponse  stepResponse;
+    float         selfTestOutput[SELF_TEST_LEVELS];   // settled points of the mask under test
+    float         selfTestFeedback[SELF_TEST_LEVELS];
+    float         selfTestRiseSum = 0.0f;
+
     const char* currentPhaseName = "Off";
     float       currentPowerPercent = 0.0f;
     uint8_t     currentBallastMask = 0;
@@ -56,12 +119,12 @@ private:
     float       scheduleTargetPower = 0.0f;
 
     unsigned long lastBallastSwitchTime = 0;
+    unsigned long ballastChangeMs[3] = {0, 0, 0}; // last on/off of B1-B3, for the minimum dwell
+    uint8_t       dwellArmed = 0;                 // ballasts switched since boot (others are free)
     unsigned long transitionStartTime = 0;
 
     bool          isFault = false;
-    unsigned long faultCheckTimer = 0;
-
-    float       outputPercent = 0.0f; // 0-100%, converted to PWM only at analogWrite
+    FaultDetector faultDetector;
 
     bool          transformerOn = false;
     unsigned long transformerOnTime = 0;
@@ -78,28 +141,85 @@ private:
     long        cachedStopSeconds = 0;
 
     TimeController* timeCtrl = nullptr;
-    unsigned long stabilityWindowStart = 0;
+    SettleDetector settle;
+    unsigned long stepStartTime = 0;
+
+    // Look-ahead planner (planTransitions): next lit mask change on the day's power curve
+    uint8_t       plannedMask = 0;          // 0 = none within PLAN_LEAD_S
+    long          plannedSwitchSeconds = 0; // schedule second it takes over
+    float         plannedPower = 0.0f;      // per-tube target right after that switch
+    long          lastPlanSeconds = -1;
+    bool          plannedTransition = false; // the running transition was started by the plan
+    long          boundarySeconds = 0;       // boundary the running transition serves
+    float         preDimFrom = 0.0f;
+    unsigned long preDimMs = 0;
 
     bool          softStartActive = false;
     unsigned long softStartBeginMs = 0;
     bool          firstUpdate = true;
 
-    void detectFaults();
+    FeedforwardMap ffMap;
+    BallastModel  model;
+    AdcCalibration adcCal;
+    uint8_t       lastBandgapCount = 0;
+    float         supplyBandgap = 0.0f;   // filtered bandgap reading, counts; 0 = none yet
+    float         supplyRatio = 1.0f;
+    bool          calPointPending = false;
+    float         calPointCounts = 0.0f;  // first calibration point
+    float         calPointVolts = 0.0f;
+    unsigned long lastFfLearnMs = 0;
+    unsigned long lastModelSaveMs = 0;
+    unsigned long lastModelSampleMs = 0;
+    float         lastModelSampleOutput = -100.0f; // forces the first sample
+    uint8_t       modelWindow = 0;        // last feedback window seen by observeFeedback()
+    uint8_t       modelHistory = 0;       // consecutive windows behind it (0-2)
+    float         modelOutput = 0.0f;     // output and feedback at that window...
+    float         modelFeedback = 0.0f;
+    float         modelOutputStep = 0.0f; // ...and their change from the window before
+    float         modelFeedbackStep = 0.0f;
+
+    unsigned long lastCheckpointMs = 0;
+    uint8_t       checkpointMask = 0xFF; // mask in the last written checkpoint (0xFF = none yet)
+
     void runScheduler(long nowSeconds, long startSeconds, long stopSeconds);
     void processActiveBlock(long blockStartSeconds, long blockDuration,
                             const SchedulePhase* phases, int phaseCount,
                             long nowSeconds, bool isMorning);
     void updateDailyRotation(time_t now);
+    void applyRotation(int day);
+    void restoreCheckpoint(const Checkpoint& cp, time_t nowUtc);
+    void updateCheckpoint();
     uint8_t selectOptimalMask(float systemPower, bool isMorning) const;
+    uint8_t maskFor(float systemPower, bool isMorning, bool warm) const;
+    float   perTubePower(float systemPower, uint8_t mask, bool warm) const;
+    float   systemPowerAt(long seconds, bool& isMorning) const;
+    static const SchedulePhase* findPhase(const SchedulePhase* phases, int phaseCount, float blockProgress);
+    static float phasePower(const SchedulePhase& phase, float blockProgress);
+    void    planTransitions(long nowSeconds);
+    bool    planDue() const;
+    float   preDimTarget() const;
     void manageTransitions();
     void manageTransformer();
     void setBallasts(uint8_t mask);
+    uint8_t dwellLimited(uint8_t mask) const;
     int  countTubesInMask(uint8_t mask) const;
 
     bool tubesAreWarm() const;
     float ballastOverhead(uint8_t mask) const;
     float getFeedbackVoltagePercent() const;
+    float feedforwardFor(float targetPercent) const;
+    float expectedFeedback(float outputPercent) const;
     void  regulateOutputVoltage();
+    void  learnModels(bool hold);
+    void  observeFeedback(bool hold);
+    bool  waitForSettle(unsigned long elapsed, unsigned long& latency);
+    void  trackSupply();
+    void  applyFeedbackScale();
+    void  applyCalibration(const AdcCalibration& previous);
+    void  runSelfTest();
+    float selfTestLevelPercent(uint8_t level) const;
+    void  finishSelfTestMask(uint8_t mask);
+    uint8_t distinctSelfTestLevels() const;
 };
 
 #endif // LIGHTING_CONTROLLER_H
@@ -0,0 +1,165 @@
+#include "OutputRegulator.h"
+#include "FeedbackAdc.h"
+#include "EmiWindow.h"
+#include "Constants.h"
+
+#ifdef __AVR__
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#else
+#define ATOMIC_BLOCK(type)
+#endif
+
+static const uint16_t Q16_FULL = 65535;            // feedback/target: 100%
+static const int32_t  Q24_FULL = 16777216L;        // output: 100%, 8 extra bits so small errors still move it
+static const int32_t  KP_Q8 = (int32_t)(VOLTAGE_KP * 256.0f + 0.5f);
+static const int32_t  KI_Q16 = (int32_t)(VOLTAGE_KI / REGULATOR_RATE_HZ * 65536.0f + 0.5f); // per tick
+static const int32_t  MAX_STEP_Q24 = (int32_t)(MAX_VOLTAGE_STEP / 100.0f * Q24_FULL + 0.5f);
+
+static volatile uint16_t targetQ16 = 0;
+static volatile int32_t  feedforwardQ24 = 0;
+static int32_t           integralQ24 = 0;        // ISR-owned except for setOutputPercent
+static volatile bool     holdOutput = true;       // nothing is driven until the first set()
+static volatile int32_t  outputQ24 = 0;
+static volatile uint16_t feedbackQ16 = 0;
+static volatile uint8_t  lastWindow = 0;
+
+// Window sum -> 1-10V feedback fraction, set by setFeedbackScale()
+static uint16_t feedbackGainQ14 = 0;
+static uint16_t feedbackOffsetQ16 = 0;
+
+// Same levels analogWrite() would produce on VOLTAGE_OUTPUT_PIN, minus its pinMode/table lookups
+static void writeDuty(uint8_t duty) {
+#ifdef __AVR__
+    static_assert(VOLTAGE_OUTPUT_PIN == 5, "writeDuty drives OC0B (pin 5) directly");
+    if (duty == 0) {
+        TCCR0A &= ~_BV(COM0B1);
+        VoltageOutputPin::low();
+    } else if (duty == ANALOG_WRITE_RESOLUTION) {
+        TCCR0A &= ~_BV(COM0B1);
+        VoltageOutputPin::high();
+    } else {
+        OCR0B = duty;
+        TCCR0A |= _BV(COM0B1);
+    }
+#else
+    analogWrite(VOLTAGE_OUTPUT_PIN, duty);
+#endif
+}
+
+// First-order sigma-delta: the output is kept in 1/2^PWM_DITHER_BITS of a PWM step and the
+// fraction is carried between ticks, so adjacent duties alternate and the RC-filtered mean
+// lands between them instead of on the 8-bit grid.
+static uint8_t ditherResidual = 0;
+
+static void writeOutput() {
+    uint16_t duty = (((uint32_t)outputQ24 * ANALOG_WRITE_RESOLUTION) >> (24 - PWM_DITHER_BITS)) + ditherResidual;
+    ditherResidual = duty & ((1 << PWM_DITHER_BITS) - 1);
+    writeDuty(ANALOG_WRITE_RESOLUTION - (duty >> PWM_DITHER_BITS)); // inverted driver stage
+}
+
+void OutputRegulator::begin() {
+    lastWindow = FeedbackAdc::windowCount() - 1; // convert the current window on the first tick
+
+#ifdef __AVR__
+    TCCR1A = 0;
+    TCCR1B = _BV(WGM12) | _BV(CS11) | _BV(CS10);  // CTC on OCR1A, clk/64 = 250 kHz
+    OCR1A = F_CPU / 64 / REGULATOR_RATE_HZ - 1;
+    TCNT1 = 0;
+    TIMSK1 = _BV(OCIE1A);
+#endif
+}
+
+// Q14 keeps a full window sum (18 bits) times the gain (~13 bits) inside 32 bits unsigned
+void OutputRegulator::setFeedbackScale(float zeroCounts, float fullCounts, float supplyRatio) {
+    float span = fullCounts - zeroCounts;
+    uint16_t gain = (uint16_t)(supplyRatio / (ADC_WINDOW_SAMPLES * span) * 65536.0f * 16384.0f + 0.5f);
+    uint16_t offset = (uint16_t)(zeroCounts / span * 65536.0f + 0.5f);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        feedbackGainQ14 = gain;
+        feedbackOffsetQ16 = offset;
+    }
+}
+
+void OutputRegulator::set(float targetPercent, float feedforwardPercent, bool hold) {
+    uint16_t target = (uint16_t)(constrain(targetPercent, 0.0f, 100.0f) * (Q16_FULL / 100.0f));
+    int32_t feedforward = (int32_t)(constrain(feedforwardPercent, 0.0f, 100.0f) * (Q24_FULL / 100.0f));
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        targetQ16 = target;
+        feedforwardQ24 = feedforward;
+        holdOutput = hold;
+    }
+}
+
+void OutputRegulator::setOutputPercent(float percent) {
+    int32_t output = (int32_t)(constrain(percent, 0.0f, 100.0f) * (Q24_FULL / 100.0f));
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        outputQ24 = output;
+        feedforwardQ24 = output;
+        integralQ24 = 0;
+        writeOutput();
+    }
+}
+
+float OutputRegulator::getOutputPercent() {
+    int32_t output;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        output = outputQ24;
+    }
+    return output * (100.0f / Q24_FULL);
+}
+
+float OutputRegulator::getFeedbackPercent() {
+    uint16_t feedback;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        feedback = feedbackQ16;
+    }
+    return feedback * (100.0f / Q16_FULL);
+}
+
+uint8_t OutputRegulator::readFeedback(float& percent) {
+    uint16_t feedback;
+    uint8_t window;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        feedback = feedbackQ16;
+        window = lastWindow;
+    }
+    percent = feedback * (100.0f / Q16_FULL);
+    return window;
+}
+
+void OutputRegulator::tick() {
+    // Feedback only changes once per mains window (FeedbackAdc); convert it then
+    uint8_t window = FeedbackAdc::windowCount();
+    if (window != lastWindow) {
+        lastWindow = window;
+        int32_t feedback = (int32_t)((FeedbackAdc::windowSum() * feedbackGainQ14) >> 14) - feedbackOffsetQ16;
+        feedbackQ16 = constrain(feedback, 0L, (int32_t)Q16_FULL);
+    }
+
+    // Feedback is frozen during a relay blackout (FeedbackAdc drops those windows): hold too
+    if (!holdOutput && !EmiWindow::blackout) {
+        int32_t error = (int32_t)targetQ16 - feedbackQ16;
+        int32_t proportional = error * KP_Q8;                          // Q16 x Q8 = Q24
+        integralQ24 = constrain(integralQ24 + ((error * KI_Q16) >> 8), -Q24_FULL, Q24_FULL);
+
+        int32_t desired = constrain(feedforwardQ24 + proportional + integralQ24, 0L, Q24_FULL);
+        int32_t step = constrain(desired - outputQ24, -MAX_STEP_Q24, MAX_STEP_Q24);
+        outputQ24 += step;
+
+        // Anti-windup: while clamped or slewing, back-calculate the integrator from the output
+        // actually applied so it neither winds up nor kicks when the limit releases
+        if (outputQ24 != feedforwardQ24 + proportional + integralQ24) {
+            integralQ24 = outputQ24 - feedforwardQ24 - proportional;
+        }
+    } else {
+        integralQ24 = outputQ24 - feedforwardQ24; // bumpless release from hold
+    }
+    writeOutput(); // keeps dithering while held
+}
+
+#ifdef __AVR__
+ISR(TIMER1_COMPA_vect) {
+    OutputRegulator::tick();
+}
+#endif
@@ -0,0 +1,37 @@
+#ifndef OUTPUT_REGULATOR_H
+#define OUTPUT_REGULATOR_H
+
+#include <Arduino.h>
+
+// Feedback -> PWM regulation step, run by the Timer1 compare ISR at REGULATOR_RATE_HZ
+// (OutputRegulator.cpp) so gain and slew rate no longer depend on how fast loop() runs.
+// PI on the feedback error around a feedforward output, slew-limited, with the integrator
+// tracking the applied output whenever the clamp or the slew limit is active (anti-windup).
+// The scheduler posts target and feedforward through set(); the ISR owns the output.
+// Internally fixed-point: feedback and target in 1/65536 of full scale, output in 1/2^24.
+class OutputRegulator {
+public:
+    static void begin();
+
+    // Window mean (ADC counts) at 0% and 100% feedback, and the factor (supply now / supply at
+    // calibration) the counts are multiplied by first - see AdcCalibration
+    static void setFeedbackScale(float zeroCounts, float fullCounts, float supplyRatio);
+
+    // Mailbox: new target (0-100% feedback), the output expected to reach it, and whether to
+    // hold the output where it is
+    static void set(float targetPercent, float feedforwardPercent, bool hold);
+
+    // Jump the output without ramping (checkpoint resume, model seed on a relay switch); it also
+    // becomes the feedforward with the integrator cleared, so the next set() continues from it
+    static void setOutputPercent(float percent);
+
+    static float getOutputPercent();
+    static float getFeedbackPercent();
+
+    // Feedback together with the ADC window it was converted from (FeedbackAdc::windowCount)
+    static uint8_t readFeedback(float& percent);
+
+    static void tick(); // one regulation step - ISR context on AVR, the plant model's clock on the host
+};
+
+#endif // OUTPUT_REGULATOR_H
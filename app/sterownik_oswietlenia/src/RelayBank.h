@@ -0,0 +1,52 @@
+#ifndef RELAY_BANK_H
+#define RELAY_BANK_H
+
+#include "Schedule.h"
+
+// Transformer + ballast relays, parameterised on compile-time pin types.
+// Relay modules are active LOW: LOW = energised (on), HIGH = released (off).
+template<class TransformerPin, class B1Pin, class B2Pin, class B3Pin>
+struct RelayBank {
+    // Energise cycles since boot - [0] transformer, [1-3] B1-B3 - the number relay and
+    // cathode wear follows
+    static uint16_t cycles[4];
+
+    static void begin() {
+        // Drive HIGH before switching to output so the relays never see a LOW glitch
+        TransformerPin::high(); TransformerPin::output();
+        B1Pin::high();          B1Pin::output();
+        B2Pin::high();          B2Pin::output();
+        B3Pin::high();          B3Pin::output();
+        energised = 0;
+        for (uint8_t i = 0; i < 4; i++) cycles[i] = 0;
+    }
+
+    static void setTransformer(bool on) {
+        if (on && !(energised & 1)) cycles[0]++;
+        energised = on ? (energised | 1) : (energised & ~1);
+        TransformerPin::write(!on);
+    }
+
+    static void setBallasts(uint8_t mask) {
+        uint8_t bits = (mask & (BALLAST_1 | BALLAST_2 | BALLAST_3)) << 1;
+        uint8_t rising = bits & ~energised;
+        for (uint8_t i = 1; i < 4; i++) {
+            if (rising & (1 << i)) cycles[i]++;
+        }
+        energised = (energised & 1) | bits;
+        B1Pin::write(!(mask & BALLAST_1));
+        B2Pin::write(!(mask & BALLAST_2));
+        B3Pin::write(!(mask & BALLAST_3));
+    }
+
+private:
+    static uint8_t energised; // bit 0 transformer, bits 1-3 B1-B3
+};
+
+template<class TransformerPin, class B1Pin, class B2Pin, class B3Pin>
+uint16_t RelayBank<TransformerPin, B1Pin, B2Pin, B3Pin>::cycles[4] = {0, 0, 0, 0};
+
+template<class TransformerPin, class B1Pin, class B2Pin, class B3Pin>
+uint8_t RelayBank<TransformerPin, B1Pin, B2Pin, B3Pin>::energised = 0;
+
+#endif // RELAY_BANK_H
@@ -0,0 +1,68 @@
+#ifndef RTC_BACKEND_H
+#define RTC_BACKEND_H
+
+#include <Arduino.h>
+#include <TimeLib.h>
+
+// Hardware RTC as seen by TimeController. Times are UTC epoch seconds.
+// The backend is chosen at compile time in main.ino (RTC_USE_DS3231 in Constants.h).
+class RtcBackend {
+public:
+    virtual void   begin() = 0;
+    virtual time_t readTime() = 0;              // 0 if the snapshot failed validation
+    virtual void   writeTime(time_t utc) = 0;
+
+    // Battery-backed scratch RAM (checkpoint storage); scratchSize() == 0 if the chip has none
+    virtual uint8_t scratchSize() const { return 0; }
+    virtual void    readScratch(uint8_t* p, uint8_t len) {}
+    virtual void    writeScratch(const uint8_t* p, uint8_t len) {}
+
+    virtual bool lostPower() { return false; }   // chip-reported oscillator stop, if supported
+    virtual bool readTemperature(float& celsius) { return false; }
+
+    static const time_t EPOCH_2000 = 946684800UL;  // 2000-01-01 00:00:00 UTC
+    static const time_t EPOCH_2100 = 4102444800UL; // RTC year registers are 00-99
+
+protected:
+    static bool bcdToBin(uint8_t bcd, uint8_t lo, uint8_t hi, uint8_t& out) {
+        if ((bcd & 0x0F) > 9) return false;
+        out = (bcd >> 4) * 10 + (bcd & 0x0F);
+        return out >= lo && out <= hi;
+    }
+
+    static uint8_t binToBcd(uint8_t bin) {
+        return ((bin / 10) << 4) | (bin % 10);
+    }
+
+    // Validates BCD clock fields (year 00-99 = 2000-2099) and converts straight to epoch seconds.
+    // Returns 0 for any invalid nibble, out-of-range field or non-existent date.
+    static time_t bcdToEpoch(uint8_t bcdSec, uint8_t bcdMin, uint8_t bcdHour,
+                             uint8_t bcdDay, uint8_t bcdMonth, uint8_t bcdYear) {
+        uint8_t sec, min, hr, day, mon, yr;
+        if (!bcdToBin(bcdSec, 0, 59, sec))   return 0;
+        if (!bcdToBin(bcdMin, 0, 59, min))   return 0;
+        if (!bcdToBin(bcdHour, 0, 23, hr))   return 0;
+        if (!bcdToBin(bcdDay, 1, 31, day))   return 0;
+        if (!bcdToBin(bcdMonth, 1, 12, mon)) return 0;
+        if (!bcdToBin(bcdYear, 0, 99, yr))   return 0;
+
+        static const uint8_t DAYS_IN_MONTH[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        uint8_t monthDays = DAYS_IN_MONTH[mon - 1] + ((mon == 2 && (yr % 4) == 0) ? 1 : 0);
+        if (day > monthDays) return 0;
+
+        return (time_t)daysFromCivil(2000 + yr, mon, day) * 86400UL
+             + hr * 3600UL + min * 60UL + sec;
+    }
+
+    // Days since 1970-01-01 for a proleptic Gregorian date (H. Hinnant's days_from_civil, y >= 0)
+    static long daysFromCivil(int y, uint8_t m, uint8_t d) {
+        if (m <= 2) y--;
+        long era = y / 400;
+        unsigned long yoe = y - era * 400;
+        unsigned long doy = (153UL * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+        unsigned long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097L + (long)doe - 719468L;
+    }
+};
+
+#endif // RTC_BACKEND_H
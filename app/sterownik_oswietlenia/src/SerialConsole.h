@@ -0,0 +1,153 @@
+#ifndef SERIAL_CONSOLE_H
+#define SERIAL_CONSOLE_H
+
+#include <Arduino.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Constants.h"
+#include "LightingController.h"
+
+// Maintenance console on the USB serial port, one command per line:
+//   test    run the ballast self-test (LightingController::startSelfTest)
+//   stop    abort it
+//   report  print the results of the last run
+//   cal V   calibration point: V = the 1-10V line voltage read off a meter (two points, >= 3 V apart)
+//   cal reset  back to the nominal feedback scaling
+//   adc     print the feedback calibration and the supply measured against the bandgap
+// Each mask's line is printed as soon as the test finishes it. Input is drained without
+// blocking; an over-long line is dropped.
+class SerialConsole {
+public:
+    explicit SerialConsole(LightingController& lighting) : lighting(lighting) {}
+
+    void begin() {
+        Serial.begin(SERIAL_CONSOLE_BAUD);
+    }
+
+    void update() {
+        while (Serial.available() > 0) {
+            char c = (char)Serial.read();
+            if (c == '\r' || c == '\n') {
+                if (length > 0 && length < sizeof(line)) {
+                    line[length] = '\0';
+                    execute();
+                }
+                length = 0;
+            } else if (length < sizeof(line)) {
+                line[length++] = c; // length == sizeof(line) marks an overflow until the newline
+            }
+        }
+
+        if (lighting.selfTestMasksDone != reportedMasks) {
+            reportedMasks = lighting.selfTestMasksDone;
+            if (reportedMasks > 0) printResult(lighting.selfTestLastMask);
+        }
+        bool running = lighting.isSelfTestRunning();
+        if (wasRunning && !running) {
+            Serial.println(reportedMasks == BallastModel::MASKS ? F("self-test done, models saved") : F("self-test aborted"));
+        }
+        wasRunning = running;
+    }
+
+private:
+    LightingController& lighting;
+    char    line[12];
+    uint8_t length = 0;
+    uint8_t reportedMasks = 0;
+    bool    wasRunning = false;
+
+    void execute() {
+        if (strcmp(line, "test") == 0) {
+            if (!lighting.startSelfTest()) {
+                Serial.println(F("self-test refused: fault latched or already running"));
+                return;
+            }
+            reportedMasks = 0;
+            Serial.println(F("self-test started"));
+        } else if (strcmp(line, "stop") == 0) {
+            lighting.stopSelfTest();
+        } else if (strcmp(line, "report") == 0) {
+            for (uint8_t mask = 1; mask <= BallastModel::MASKS; mask++) {
+                if (lighting.selfTestResults[mask - 1].gain != 0.0f) printResult(mask);
+            }
+        } else if (strcmp(line, "cal reset") == 0) {
+            lighting.resetFeedbackCalibration();
+            printCalibration();
+        } else if (strncmp(line, "cal ", 4) == 0) {
+            calibrate(atof(line + 4));
+        } else if (strcmp(line, "adc") == 0) {
+            printCalibration();
+        } else {
+            Serial.println(F("commands: test, stop, report, cal <volts>, cal reset, adc"));
+        }
+    }
+
+    void calibrate(float volts) {
+        if (volts < 0.5f || volts > 11.0f) {
+            Serial.println(F("cal: expected the line voltage, e.g. cal 9.87"));
+            return;
+        }
+        switch (lighting.calibrateFeedback(volts)) {
+            case 1:
+                Serial.println(F("cal: point 1 taken - move the output at least 3 V, then enter point 2"));
+                break;
+            case 2:
+                printCalibration();
+                break;
+            default:
+                Serial.println(F("cal: rejected (points too close or implausible) - start over"));
+                break;
+        }
+    }
+
+    void printCalibration() {
+        const AdcCalibration& cal = lighting.getFeedbackCalibration();
+        Serial.print(F("adc: 1V = "));
+        Serial.print(cal.zeroCounts, 1);
+        Serial.print(F(", 10V = "));
+        Serial.print(cal.fullCounts, 1);
+        Serial.print(F(" counts, supply x"));
+        Serial.print(lighting.getSupplyRatio(), 4);
+        Serial.print(F(" (~"));
+        Serial.print(lighting.getSupplyVolts(), 2);
+        Serial.println(F(" V)"));
+    }
+
+    // Measured line plus the PI gains it calls for - SIMC rule for a first-order line with one
+    // ADC window of dead time and the closed loop as fast as the open one (the feedforward does
+    // the rest): KP = tau / (gain * (tau + window)), KI = KP / tau. Compare with VOLTAGE_KP/KI.
+    void printResult(uint8_t mask) {
+        const LightingController::SelfTestResult& r = lighting.selfTestResults[mask - 1];
+        Serial.print(F("mask "));
+        Serial.print(mask);
+        Serial.print(F(": rise "));
+        Serial.print(r.riseMs);
+        Serial.print(F(" ms, overshoot "));
+        Serial.print(r.overshoot, 1);
+        Serial.print(F("%, steady-state error "));
+        Serial.print(r.steadyError, 2);
+        if (r.gain < 0.0f) {
+            Serial.println(F("%, levels clamped - not fitted"));
+            return;
+        }
+        Serial.print(F("%, linearity "));
+        Serial.print(r.linearity, 2);
+        Serial.print(F("%, gain "));
+        Serial.print(r.gain, 3);
+        if (r.gain < MODEL_MIN_GAIN || r.gain > MODEL_MAX_GAIN) {
+            Serial.println(F(" - out of range, not stored"));
+            return;
+        }
+        if (r.steps > 0) {
+            float tau = r.riseMs / log(9.0f);
+            float kp = tau / (r.gain * (tau + ADC_WINDOW_MS));
+            Serial.print(F(", suggested KP "));
+            Serial.print(kp, 2);
+            Serial.print(F(" KI "));
+            Serial.print(kp * 1000.0f / tau, 1);
+        }
+        Serial.println();
+    }
+};
+
+#endif // SERIAL_CONSOLE_H
@@ -0,0 +1,52 @@
+#ifndef SETTLE_DETECTOR_H
+#define SETTLE_DETECTOR_H
+
+#include <Arduino.h>
+#include "Constants.h"
+
+// Decides when the regulated feedback has settled on its target, from one sample per
+// feedback window. Error and its rate of change are low-pass filtered with the loop's own
+// time constant; both must stay small for SETTLE_TAUS time constants. A fast loop therefore
+// settles in well under a second. A slow or oscillating one is never called settled on a
+// lucky zero crossing, because the rate term catches it.
+class SettleDetector {
+public:
+    float filteredError = 0.0f;  // %
+    float errorRate = 0.0f;      // %/s
+
+    void reset() {
+        primed = false;
+        settledSinceMs = 0;
+    }
+
+    void sample(float error, unsigned long tauMs) {
+        if (!primed) {
+            filteredError = error;
+            errorRate = 0.0f;
+            primed = true;
+        } else {
+            float alpha = ADC_WINDOW_MS / (ADC_WINDOW_MS + tauMs);
+            float previous = filteredError;
+            filteredError += alpha * (error - filteredError);
+            errorRate += alpha * ((filteredError - previous) * 1000.0f / ADC_WINDOW_MS - errorRate);
+        }
+
+        bool quiet = abs(filteredError) < SETTLE_MAX_ERROR && abs(errorRate) < SETTLE_MAX_RATE;
+        if (!quiet) {
+            settledSinceMs = 0;
+        } else if (settledSinceMs == 0) {
+            settledSinceMs = max(millis(), 1UL);
+        }
+    }
+
+    bool settled(unsigned long tauMs) const {
+        unsigned long window = max(SETTLE_TAUS * tauMs, SETTLE_MIN_WINDOW_MS);
+        return settledSinceMs != 0 && millis() - settledSinceMs >= window;
+    }
+
+private:
+    bool          primed = false;
+    unsigned long settledSinceMs = 0;
+};
+
+#endif // SETTLE_DETECTOR_H
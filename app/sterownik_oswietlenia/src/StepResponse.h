@@ -0,0 +1,71 @@
+#ifndef STEP_RESPONSE_H
+#define STEP_RESPONSE_H
+
+#include <Arduino.h>
+#include "Constants.h"
+
+// One open-loop output step of the 1-10V line, sampled once per feedback window - the fastest
+// rate the ADC gives free of mains ripple. Only the first SELF_TEST_TRACE_WINDOWS samples are
+// kept, for the 10-90% rise and the overshoot; the end of the dwell is averaged into the
+// settled value as it arrives.
+class StepResponse {
+public:
+    float start = 0.0f;    // feedback before the step, %
+    float settled = 0.0f;  // mean over the last SELF_TEST_SETTLED_WINDOWS of the dwell, %
+
+    void begin(float startFeedback) {
+        start = startFeedback;
+        count = 0;
+        settledSum = 0.0f;
+    }
+
+    // True once SELF_TEST_DWELL_WINDOWS samples are in
+    bool sample(float feedback) {
+        if (count < SELF_TEST_TRACE_WINDOWS) trace[count] = (uint16_t)(constrain(feedback, 0.0f, 100.0f) * 100.0f + 0.5f);
+        if (count >= SELF_TEST_DWELL_WINDOWS - SELF_TEST_SETTLED_WINDOWS) settledSum += feedback;
+        if (++count < SELF_TEST_DWELL_WINDOWS) return false;
+        settled = settledSum / SELF_TEST_SETTLED_WINDOWS;
+        return true;
+    }
+
+    // Moved far enough that rise and overshoot are not just noise
+    bool measurable() const { return abs(settled - start) >= SELF_TEST_MIN_STEP; }
+
+    // 10-90% of the step, interpolated between windows; the trace length if it never got there
+    float riseMs() const {
+        float top = crossing(0.9f);
+        if (top >= SELF_TEST_TRACE_WINDOWS) return SELF_TEST_TRACE_WINDOWS * ADC_WINDOW_MS;
+        return (top - crossing(0.1f)) * ADC_WINDOW_MS;
+    }
+
+    // Largest excursion beyond the settled value, % of the step. Taken over three-window means:
+    // real ringing lasts several windows, a single noisy window does not.
+    float overshootPercent() const {
+        float peak = 1.0f;
+        for (uint8_t i = 2; i < SELF_TEST_TRACE_WINDOWS; i++) {
+            peak = max(peak, (progress(i - 2) + progress(i - 1) + progress(i)) / 3.0f);
+        }
+        return (peak - 1.0f) * 100.0f;
+    }
+
+private:
+    uint16_t trace[SELF_TEST_TRACE_WINDOWS]; // centi-percent
+    uint8_t  count = 0;
+    float    settledSum = 0.0f;
+
+    float progress(uint8_t i) const { return (trace[i] / 100.0f - start) / (settled - start); }
+
+    // Fractional window index at which the response first reaches 'fraction' of the step,
+    // counting the start as window -1
+    float crossing(float fraction) const {
+        float previous = 0.0f;
+        for (uint8_t i = 0; i < SELF_TEST_TRACE_WINDOWS; i++) {
+            float p = progress(i);
+            if (p >= fraction) return i - 1 + (fraction - previous) / (p - previous);
+            previous = p;
+        }
+        return SELF_TEST_TRACE_WINDOWS;
+    }
+};
+
+#endif // STEP_RESPONSE_H
@@ -1,45 +1,49 @@
 #ifndef TIME_CONTROLLER_H
 #define TIME_CONTROLLER_H
 
-#include <virtuabotixRTC.h>
 #include <TimeLib.h>
+#include "RtcBackend.h"
 #include "Constants.h"
 #include "Settings.h"
 #include "Timezones.h"
+#include "Checkpoint.h"
+#include "EmiWindow.h"
 
 class TimeController {
 public:
-    TimeController(uint8_t clk, uint8_t dat, uint8_t rst) : rtc(clk, dat, rst) {}
+    TimeController(RtcBackend& rtc) : rtc(rtc) {}
 
+    uint8_t bootReadCount = 0;
     uint8_t bootValidCount = 0;
     uint8_t bootQuorumSize = 0;
     bool bootQuorumReached = false;
     uint16_t runtimeBadReads = 0;
-
-    void suppressReads(unsigned long durationMs) {
-        unsigned long until = millis() + durationMs;
-        if (until > suppressUntil) {
-            suppressUntil = until;
-        }
-    }
+    uint16_t lastReadMicros = 0; // duration of the last RTC bus read (DS1302_SLOW_IO to compare)
+    bool rtcPowerLost = false;   // RTC POR suspected (checkpoint lost, RTC behind it, or OSF) - time suspect
+    long driftPpm = 0;           // millis() rate error vs RTC, + = millis() runs fast
+    unsigned long syncIntervalMs = RTC_SYNC_INTERVAL_MS; // current adaptive RTC sync interval
 
     void begin() {
         rtc.begin();
 
-        const uint8_t NUM_READS = 7;
-        time_t readings[NUM_READS];
-        for (uint8_t i = 0; i < NUM_READS; i++) {
-            readings[i] = getRawRtcTime();
-            if (i < NUM_READS - 1) delay(30);
-        }
-
-        uint8_t validCount = 0;
-        for (uint8_t i = 0; i < NUM_READS; i++) {
-            if (isTimeValid(readings[i])) validCount++;
+        checkpointValid = loadCheckpoint(checkpoint);
+        // Scratch RAM is wiped with the clock on an RTC POR (also the case on the first boot of this
+        // firmware); an RTC with its own oscillator-stop flag reports it directly, and keeps the
+        // checkpoint in EEPROM, where it is only missing on the first boot
+        rtcPowerLost = rtc.lostPower() || (rtc.scratchSize() > 0 && !checkpointValid);
+
+        // A valid checkpoint is a lower bound, not a vote - it was stamped before the reset, so it
+        // cannot agree with the RTC to +-2s: readings behind it are rejected. Its time was
+        // extrapolated from millis() and may run a little ahead of the RTC.
+        time_t notBefore = checkpointValid ? (time_t)checkpoint.utc - CHECKPOINT_CLOCK_TOLERANCE_S
+                                           : RtcBackend::EPOCH_2000;
+        time_t initialTime = readQuorumTime(BOOT_QUORUM_SIZE, notBefore);
+
+        // Time never restarts behind the checkpoint: the RTC lost time
+        if (checkpointValid && (!isTimeValid(initialTime) || initialTime < notBefore)) {
+            initialTime = checkpoint.utc;
+            rtcPowerLost = true;
         }
-        bootValidCount = validCount;
-
-        time_t initialTime = getQuorumTime(readings, NUM_READS);
 
         ::setTime(initialTime);
         lastKnownGoodTime = initialTime;
@@ -49,26 +53,59 @@ public:
     time_t nowUTC() {
         unsigned long now = millis();
 
-        bool suppressed = (suppressUntil != 0 && now < suppressUntil);
-        if (suppressed) {
-            return lastKnownGoodTime + (now - lastSyncMillis) / 1000;
+        if (EmiWindow::active()) {
+            return extrapolate(now);
         }
-        suppressUntil = 0;
 
-        if (now - lastSyncMillis < RTC_SYNC_INTERVAL_MS) {
-            return lastKnownGoodTime + (now - lastSyncMillis) / 1000;
+        // Right after a relay blackout, check the RTC instead of waiting out the sync interval:
+        // that transient is exactly what could have disturbed it
+        bool verifyAfterEmi = EmiWindow::closedSince(seenEmiWindows);
+
+        if (!verifyAfterEmi && now - lastSyncMillis < syncIntervalMs) {
+            return extrapolate(now);
         }
 
         time_t rawTime = getRawRtcTime();
 
         if (isTimeValid(rawTime)) {
+            discipline(rawTime, now);
             lastKnownGoodTime = rawTime;
             lastSyncMillis = now;
             return rawTime;
         }
 
         runtimeBadReads++;
-        return lastKnownGoodTime + (now - lastSyncMillis) / 1000;
+        return extrapolate(now);
+    }
+
+    // Checkpoint read from the RTC's scratch at boot; false if it was missing or corrupt
+    bool getCheckpoint(Checkpoint& cp) const {
+        if (!checkpointValid) return false;
+        cp = checkpoint;
+        return true;
+    }
+
+    // Stamps the checkpoint with the current UTC estimate and writes it to the RTC's scratch.
+    // Skipped (returns false) inside a relay EMI window or without a valid time.
+    bool saveCheckpoint(Checkpoint& cp) {
+        unsigned long now = millis();
+        if (EmiWindow::active()) return false;
+        if (!isTimeValid(lastKnownGoodTime)) return false;
+
+        cp.magic = CHECKPOINT_MAGIC;
+        cp.utc = extrapolate(now);
+        cp.crc = checkpointCrc(cp);
+
+        if (rtc.scratchSize() < sizeof(cp)) return false;
+        rtc.writeScratch((const uint8_t*)&cp, sizeof(cp));
+
+        checkpoint = cp;
+        checkpointValid = true;
+        return true;
+    }
+
+    bool getRtcTemperature(float& celsius) {
+        return rtc.readTemperature(celsius);
     }
 
     time_t toLocal(time_t utc, const Settings& settings) {
@@ -90,10 +127,12 @@ public:
 
         time_t utcTime = (settings.timezone == TZ_WARSAW) ? warsawTZ.toUTC(localTime) : localTime;
 
-        rtc.setDS1302Time(::second(utcTime), ::minute(utcTime), ::hour(utcTime), 0, ::day(utcTime), ::month(utcTime), ::year(utcTime));
+        rtc.writeTime(utcTime);
 
         lastKnownGoodTime = utcTime;
         lastSyncMillis = millis();
+        resetDiscipline();
+        restampCheckpoint();
     }
 
     void beginTimeEdit(const Settings& settings) {
@@ -113,9 +152,11 @@ public:
     void commitTimeEdit(const Settings& settings) {
         time_t localTime = editBaseTime + editOffset;
         time_t utcTime = (settings.timezone == TZ_WARSAW) ? warsawTZ.toUTC(localTime) : localTime;
-        rtc.setDS1302Time(::second(utcTime), ::minute(utcTime), ::hour(utcTime), 0, ::day(utcTime), ::month(utcTime), ::year(utcTime));
+        rtc.writeTime(utcTime);
         lastKnownGoodTime = utcTime;
         lastSyncMillis = millis();
+        resetDiscipline();
+        restampCheckpoint();
         editing = false;
     }
 
@@ -130,69 +171,129 @@ private:
     time_t editBaseTime = 0;
     long editOffset = 0;
 
-    virtuabotixRTC rtc;
+    RtcBackend& rtc;
+    Checkpoint checkpoint;
+    bool checkpointValid = false;
     time_t lastKnownGoodTime = 0;
     unsigned long lastSyncMillis = 0;
-    unsigned long suppressUntil = 0;
+    uint8_t seenEmiWindows = 0;
+    time_t driftAnchorTime = 0;          // RTC reading the drift baseline starts from (0 = none)
+    unsigned long driftAnchorMillis = 0;
+
+    // Last good RTC time plus millis() elapsed, corrected by the measured drift
+    time_t extrapolate(unsigned long now) const {
+        unsigned long elapsedMs = now - lastSyncMillis;
+        long correctionMs = (long)(elapsedMs * (driftPpm * 1e-6f));
+        return lastKnownGoodTime + (elapsedMs - correctionMs) / 1000;
+    }
+
+    // Called with every good RTC read: refines driftPpm over a long baseline (the RTC only
+    // resolves whole seconds) and stretches the sync interval while predictions hold.
+    void discipline(time_t rawTime, unsigned long now) {
+        long elapsedS = (long)((now - lastSyncMillis) / 1000);
+        long predictionError = (long)(rawTime - extrapolate(now));
+        long jumpLimit = 2 + elapsedS * DRIFT_MAX_PPM / 1000000L;
+        if (driftAnchorTime == 0 || labs(predictionError) > jumpLimit) {
+            // First read or time jump: restart the baseline, keep the last estimate
+            driftAnchorTime = rawTime;
+            driftAnchorMillis = now;
+            syncIntervalMs = RTC_SYNC_INTERVAL_MS;
+            return;
+        }
+
+        unsigned long baselineS = rawTime - driftAnchorTime;
+        if (baselineS >= DRIFT_MIN_BASELINE_S) {
+            long excessMs = (long)((now - driftAnchorMillis) - baselineS * 1000UL);
+            driftPpm = (long)(excessMs * 1000.0f / baselineS);
+            if (baselineS >= DRIFT_MAX_BASELINE_S) {
+                driftAnchorTime = rawTime;
+                driftAnchorMillis = now;
+            }
+        }
+
+        // Within the RTC's own 1s resolution: stable, sync less often; otherwise back to the minimum
+        if (labs(predictionError) <= 1) {
+            syncIntervalMs = min(syncIntervalMs * 2, RTC_SYNC_MAX_INTERVAL_MS);
+        } else {
+            syncIntervalMs = RTC_SYNC_INTERVAL_MS;
+        }
+    }
+
+    void resetDiscipline() {
+        driftAnchorTime = 0;
+        syncIntervalMs = RTC_SYNC_INTERVAL_MS;
+    }
+
+    bool loadCheckpoint(Checkpoint& cp) {
+        if (rtc.scratchSize() < sizeof(cp)) return false;
+        rtc.readScratch((uint8_t*)&cp, sizeof(cp));
+        return cp.magic == CHECKPOINT_MAGIC && cp.crc == checkpointCrc(cp);
+    }
+
+    // A user time set moves the clock, possibly backwards - keep the checkpoint in step
+    void restampCheckpoint() {
+        if (!checkpointValid) return;
+        Checkpoint cp = checkpoint;
+        saveCheckpoint(cp);
+    }
 
     time_t getRawRtcTime() {
-        rtc.updateTime();
-        tmElements_t tm;
-        tm.Year = rtc.year - 1970;
-        tm.Month = rtc.month;
-        tm.Day = rtc.dayofmonth;
-        tm.Hour = rtc.hours;
-        tm.Minute = rtc.minutes;
-        tm.Second = rtc.seconds;
-        return makeTime(tm);
+        unsigned long readStart = micros();
+        time_t t = rtc.readTime();
+        lastReadMicros = (uint16_t)(micros() - readStart);
+        return t;
     }
 
     bool isTimeValid(time_t t) {
-        if (t <= 0) return false;
-        int y = ::year(t);
-        int m = ::month(t);
-        int d = ::day(t);
-        int h = ::hour(t);
-        int mi = ::minute(t);
-        int s = ::second(t);
-        if (m < 1 || m > 12) return false;
-        if (d < 1 || d > 31) return false;
-        if (h > 23) return false;
-        if (mi > 59) return false;
-        if (s > 59) return false;
-        if (y < 2000 || y > 2099) return false;
-        return true;
+        return t >= RtcBackend::EPOCH_2000 && t < RtcBackend::EPOCH_2100;
     }
 
-    time_t getQuorumTime(time_t* readings, uint8_t count) {
+    // Streaming quorum: reads until 'required' valid readings agree within +-2s, at most
+    // BOOT_MAX_READS. Agreement counts are updated per reading, so consistent reads stop early.
+    time_t readQuorumTime(uint8_t required, time_t notBefore) {
+        time_t readings[BOOT_MAX_READS];
+        uint8_t matches[BOOT_MAX_READS];
+        uint8_t valid = 0;
         uint8_t bestCount = 0;
-        time_t bestTime = readings[0];
-
-        for (uint8_t i = 0; i < count; i++) {
-            if (!isTimeValid(readings[i])) continue;
-            uint8_t matches = 0;
-            for (uint8_t j = 0; j < count; j++) {
-                if (!isTimeValid(readings[j])) continue;
-                long diff = (long)(readings[j] - readings[i]);
+        time_t bestTime = 0;
+        time_t lastTime = 0;
+
+        bootReadCount = 0;
+        while (bootReadCount < BOOT_MAX_READS && bestCount < required) {
+            if (bootReadCount > 0) delay(BOOT_READ_SPACING_MS);
+            time_t t = getRawRtcTime();
+            bootReadCount++;
+            lastTime = t;
+            if (!isTimeValid(t) || t < notBefore) continue;
+
+            matches[valid] = 1;
+            for (uint8_t i = 0; i < valid; i++) {
+                long diff = (long)(t - readings[i]);
                 if (diff < 0) diff = -diff;
-                if (diff <= 2) matches++;
+                if (diff <= 2) {
+                    matches[i]++;
+                    matches[valid]++;
+                    if (matches[i] > bestCount) {
+                        bestCount = matches[i];
+                        bestTime = readings[i];
+                    }
+                }
             }
-            if (matches > bestCount) {
-                bestCount = matches;
-                bestTime = readings[i];
+            readings[valid] = t;
+            if (matches[valid] > bestCount) {
+                bestCount = matches[valid];
+                bestTime = t;
             }
+            valid++;
         }
 
+        bootValidCount = valid;
         bootQuorumSize = bestCount;
-        bootQuorumReached = (bestCount >= 3);
-
-        if (bestCount >= 3) return bestTime;
-
-        for (uint8_t i = 0; i < count; i++) {
-            if (isTimeValid(readings[i])) return readings[i];
-        }
+        bootQuorumReached = (bestCount >= required);
 
-        return readings[count - 1];
+        if (bootQuorumReached) return bestTime;
+        if (valid > 0) return readings[0];
+        return lastTime;
     }
 };
 
@@ -155,6 +155,22 @@ public:
 
                     }
 
+                    if (currentScreen == 5) {
+
+                        if (lighting.isSelfTestRunning()) {
+
+                            lighting.stopSelfTest();
+
+                        } else {
+
+                            lighting.startSelfTest();
+
+                        }
+
+                        drawCurrentScreen(true);
+
+                    }
+
                     if (currentScreen == 4) {
 
                         editMode = EditMode::OVERRIDE;
@@ -402,13 +418,13 @@ public:
 
                     space_buffer[lengths[editPos]] = '\0';
 
-                    display.print(positions[editPos][0], positions[editPos][1], space_buffer);
+                    display.print(positions[editPos][0], positions[editPos][1], space_buffer, true);
 
                 } else {
 
                     snprintf(buffer, sizeof(buffer), formats[editPos], values[editPos]);
 
-                    display.print(positions[editPos][0], positions[editPos][1], buffer);
+                    display.print(positions[editPos][0], positions[editPos][1], buffer, true);
 
                 }
 
@@ -426,13 +442,13 @@ public:
 
                     space_buffer[2] = '\0';
 
-                    display.print(positions[editPos][0], positions[editPos][1], space_buffer);
+                    display.print(positions[editPos][0], positions[editPos][1], space_buffer, true);
 
                 } else {
 
                     snprintf(buffer, sizeof(buffer), "%02d", values[editPos]);
 
-                    display.print(positions[editPos][0], positions[editPos][1], buffer);
+                    display.print(positions[editPos][0], positions[editPos][1], buffer, true);
 
                 }
 
@@ -442,11 +458,11 @@ public:
 
                     if (blinkState) {
 
-                        display.print(13, 0, "   ");
+                        display.print(13, 0, "   ", true);
 
                     } else {
 
-                        display.print(13, 0, editOverrideEnabled ? " ON" : "OFF");
+                        display.print(13, 0, editOverrideEnabled ? " ON" : "OFF", true);
 
                     }
 
@@ -454,13 +470,13 @@ public:
 
                     if (blinkState) {
 
-                        display.print(12, 1, "    ");
+                        display.print(12, 1, "    ", true);
 
                     } else {
 
                         snprintf(buffer, sizeof(buffer), "%3d%%", editOverridePower);
 
-                        display.print(12, 1, buffer);
+                        display.print(12, 1, buffer, true);
 
                     }
 
@@ -480,6 +496,7 @@ public:
             case 2: drawTimerScreen(); break;
             case 3: drawTimezoneScreen(); break;
             case 4: drawOverrideScreen(); break;
+            case 5: drawSelfTestScreen(); break;
         }
     }
 
@@ -548,6 +565,35 @@ public:
         snprintf(buffer, sizeof(buffer), "Power:      %3d%%", pwr);
         display.print(0, 1, buffer);
     }
+
+    // SET starts or aborts the self-test; the full report goes to the serial console
+    void drawSelfTestScreen() {
+        uint8_t maxMask = BallastModel::MASKS;
+        char buffer[17];
+        if (!lighting.isSelfTestRunning()) {
+            const char* state = lighting.isSystemInFault() ? "fault" : lighting.selfTestMasksDone == maxMask ? "done" : "SET";
+            snprintf(buffer, sizeof(buffer), "Self-test: %-5s", state);
+        } else if (lighting.getSelfTestStep() == 0) {
+            snprintf(buffer, sizeof(buffer), "Self-test M%u ...", min(lighting.getSelfTestMask(), maxMask));
+        } else {
+            // Mask and step are single digits; the clamps tell -Wformat-truncation so
+            snprintf(buffer, sizeof(buffer), "Self-test M%u %u/%u", min(lighting.getSelfTestMask(), maxMask),
+                     min(lighting.getSelfTestStep(), SELF_TEST_LEVELS), SELF_TEST_LEVELS);
+        }
+        display.print(0, 0, buffer);
+
+        uint8_t mask = lighting.selfTestLastMask;
+        if (mask == 0) {
+            snprintf(buffer, sizeof(buffer), "%-16s", "");
+        } else {
+            const LightingController::SelfTestResult& r = lighting.selfTestResults[mask - 1];
+            // Beyond 9999 ms or 999% the fit is meaningless anyway: show the field full
+            unsigned overshoot = (unsigned)constrain(r.overshoot + 0.5f, 0.0f, 999.0f);
+            snprintf(buffer, sizeof(buffer), "M%u %4ums os%3u%%", min(mask, maxMask),
+                     min(r.riseMs, (uint16_t)9999), min(overshoot, 999u));
+        }
+        display.print(0, 1, buffer);
+    }
 };
 
 #endif // UI_MANAGER_H
\ No newline at end of file
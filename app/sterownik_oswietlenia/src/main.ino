@@ -9,31 +9,45 @@ Timezone warsawTZ(CEST, CET);
 #include "Constants.h"
 #include "Debug.h"
 #include "Settings.h"
+#include "EmiWindow.h"
+#include "Ds1302Rtc.h"
+#include "Ds3231Rtc.h"
 #include "TimeController.h"
 #include "DisplayController.h"
 #include "InputManager.h"
 #include "LightingController.h"
 #include "UIManager.h"
+#include "SerialConsole.h"
 
 // Global objects for our controllers
 Settings settings;
-TimeController timeController(RTC_CLK_PIN, RTC_DAT_PIN, RTC_RST_PIN);
+#if defined(RTC_USE_DS3231)
+Ds3231Rtc rtcBackend;
+#elif defined(__AVR__)
+Ds1302Rtc rtcBackend(RTC_CLK_PIN, RTC_DAT_PIN, RTC_RST_PIN);
+#else
+SimulatedDs3231 rtcBackend;
+#endif
+TimeController timeController(rtcBackend);
 DisplayController displayController(LCD_ADDRESS, LCD_COLS, LCD_ROWS);
 InputManager inputManager;
 InputProcessor inputProcessor(inputManager);
 LightingController lightingController;
 UIManager uiManager(displayController, timeController, lightingController, inputProcessor, settings);
+SerialConsole serialConsole(lightingController);
 
 void setup() {
     wdt_disable();
 
-    pinMode(SWITCH_TRANSFORMER_PIN, OUTPUT);
-    digitalWrite(SWITCH_TRANSFORMER_PIN, HIGH);
+    TransformerRelayPin::high();
+    TransformerRelayPin::output();
 
-    pinMode(RTC_RST_PIN, OUTPUT);
-    digitalWrite(RTC_RST_PIN, LOW);
+    RtcRstPin::low();
+    RtcRstPin::output();
 
     displayController.begin();
+    inputManager.begin();
+    serialConsole.begin();
 
     delay(500);
 
@@ -49,6 +63,7 @@ void setup() {
 
 void loop() {
     wdt_reset();
+    EmiWindow::update();
 
     time_t utc_now = timeController.nowUTC();
     time_t local_now = timeController.toLocal(utc_now, settings);
@@ -56,13 +71,7 @@ void loop() {
     // Update all controllers
     lightingController.update(local_now, settings);
 
-    if (lightingController.relaySwitched) {
-        lightingController.relaySwitched = false;
-        timeController.suppressReads(500);
-        delay(100);
-        displayController.reinit();
-    }
-
-    displayController.update();
     uiManager.update();
+    serialConsole.update();
+    displayController.update(); // sends whatever the UI changed this pass
 }
\ No newline at end of file
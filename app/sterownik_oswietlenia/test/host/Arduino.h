@@ -0,0 +1,80 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Just enough of the Arduino core to build the controllers for [env:native].
+// Time is simulated: millis()/micros() only move when a test calls hostAdvanceMicros()
+// (delay() advances them too), so a run is repeatable to the microsecond.
+// Pins and PWM duties are plain variables the plant model reads back.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+#define NUM_HOST_PINS 22
+
+#define F(x) (x)
+#define PROGMEM
+#define PI 3.1415926535897932384626433832795
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define bit(b) (1UL << (b))
+#define bitRead(value, b) (((value) >> (b)) & 0x01)
+
+template<class A, class B> auto max(A a, B b) -> decltype(a + b) { return a > b ? a : b; }
+template<class A, class B> auto min(A a, B b) -> decltype(a + b) { return a < b ? a : b; }
+
+inline unsigned long& hostMicrosNow() { static unsigned long us = 0; return us; }
+inline void hostAdvanceMicros(unsigned long us) { hostMicrosNow() += us; }
+inline unsigned long micros() { return hostMicrosNow(); }
+inline unsigned long millis() { return hostMicrosNow() / 1000UL; }
+inline void delay(unsigned long ms) { hostMicrosNow() += ms * 1000UL; }
+inline void delayMicroseconds(unsigned int us) { hostMicrosNow() += us; }
+
+struct HostPin {
+    uint8_t mode;
+    uint8_t level;
+    int duty;   // last analogWrite()
+    int adc;    // what analogRead() returns
+};
+inline HostPin& hostPin(uint8_t pin) { static HostPin pins[NUM_HOST_PINS]; return pins[pin % NUM_HOST_PINS]; }
+
+inline void pinMode(uint8_t pin, uint8_t mode) { hostPin(pin).mode = mode; }
+inline void digitalWrite(uint8_t pin, uint8_t level) { hostPin(pin).level = level; }
+inline int digitalRead(uint8_t pin) { return hostPin(pin).level; }
+inline void analogWrite(uint8_t pin, int duty) { hostPin(pin).duty = duty; }
+inline int analogRead(uint8_t pin) { return hostPin(pin).adc; }
+
+// Output is dropped: tests report through Unity
+class HardwareSerial {
+public:
+    void begin(unsigned long) {}
+    int available() { return 0; }
+    int read() { return -1; }
+    template<class T> size_t print(T) { return 0; }
+    template<class T> size_t print(T, int) { return 0; }
+    template<class T> size_t println(T) { return 0; }
+    template<class T> size_t println(T, int) { return 0; }
+    size_t println() { return 0; }
+    size_t write(uint8_t) { return 1; }
+};
+static HardwareSerial Serial __attribute__((unused));
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,99 @@
+#ifndef CONTROLLER_RIG_H
+#define CONTROLLER_RIG_H
+
+#include <Timezone.h>
+#include "PlantModel.h"
+#include "Ds3231Rtc.h"
+#include "TimeController.h"
+#include "LightingController.h"
+
+// main.ino's boot and loop on the plant model: SimulatedDs3231, TimeController and
+// LightingController, updated every 10 ms against a local clock the test sets. Like
+// PlantModel.h, include it from exactly one file per test program.
+
+TimeChangeRule CEST = {"CEST", Last, Sun, Mar, 2, 120};
+TimeChangeRule CET = {"CET", Last, Sun, Oct, 3, 60};
+Timezone warsawTZ(CEST, CET);
+
+class ControllerRig {
+public:
+    static const time_t MONDAY = 1767571200; // 2026-01-05 00:00, local time as passed to update()
+    static const unsigned long LOOP_US = 10000;
+
+    SimulatedDs3231     rtc;        // battery-backed: survives reset()
+    TimeController*     time = nullptr;
+    LightingController* lighting = nullptr;
+    Settings            settings;   // 08:00-20:00 unless a test changes it
+    double              elapsed = 0.0; // seconds the last run() lasted
+
+    ~ControllerRig() { shutdown(); }
+
+    // First boot: erased EEPROM, fresh plant and RTC
+    void powerOn() {
+        shutdown();
+        EEPROM.erase();
+        plant = PlantModel();
+        rtc = SimulatedDs3231();
+        boot();
+    }
+
+    // Watchdog/brown-out reset: RAM and relays lost, RTC, EEPROM and lamps kept. The plant
+    // runs dark for 'outageSeconds' before the controller boots again.
+    void reset(double outageSeconds) {
+        shutdown();
+        TransformerRelayPin::high();
+        Ballast1RelayPin::high();
+        Ballast2RelayPin::high();
+        Ballast3RelayPin::high();
+        OutputRegulator::setOutputPercent(0.0f);
+        OutputRegulator::set(0.0f, 0.0f, true);
+        plant.run(outageSeconds);
+        boot();
+    }
+
+    // Local time of day (seconds) the schedule sees from now on
+    void setClock(long secondOfDay) {
+        startLocal = MONDAY + secondOfDay;
+        startMs = millis();
+    }
+
+    time_t localNow() const { return startLocal + (millis() - startMs) / 1000; }
+
+    // Main loop passes for up to 'seconds'; stops early, returning false, as soon as 'until'
+    // returns true after a pass
+    template<class Until>
+    bool run(double seconds, Until until) {
+        unsigned long begin = micros();
+        bool stopped = false;
+        for (double t = 0; t < seconds && !stopped; t += LOOP_US / 1e6) {
+            EmiWindow::update();
+            lighting->update(localNow(), settings);
+            stopped = until();
+            if (!stopped) plant.advance(LOOP_US);
+        }
+        elapsed = (micros() - begin) / 1e6;
+        return !stopped;
+    }
+
+    bool run(double seconds) { return run(seconds, [] { return false; }); }
+
+private:
+    time_t        startLocal = MONDAY;
+    unsigned long startMs = 0;
+
+    void boot() {
+        time = new TimeController(rtc);
+        lighting = new LightingController();
+        time->begin();
+        lighting->begin(*time);
+    }
+
+    void shutdown() {
+        delete lighting;
+        delete time;
+        lighting = nullptr;
+        time = nullptr;
+    }
+};
+
+#endif // CONTROLLER_RIG_H
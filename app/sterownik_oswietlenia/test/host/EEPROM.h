@@ -0,0 +1,49 @@
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+#include <stdint.h>
+#include <string.h>
+
+// ATmega328P EEPROM in RAM: 1 KB, erased to 0xFF, shared by every translation unit.
+// writeCount() lets a test check wear on the ring buffers.
+class EEPROMClass {
+public:
+    static const int SIZE = 1024;
+
+    uint8_t read(int address) { return data()[address % SIZE]; }
+    void write(int address, uint8_t value) { data()[address % SIZE] = value; writes()[address % SIZE]++; }
+    void update(int address, uint8_t value) { if (read(address) != value) write(address, value); }
+    uint16_t length() { return SIZE; }
+
+    template<class T> T& get(int address, T& t) {
+        uint8_t* p = (uint8_t*)&t;
+        for (size_t i = 0; i < sizeof(T); i++) p[i] = read(address + i);
+        return t;
+    }
+
+    template<class T> const T& put(int address, const T& t) {
+        const uint8_t* p = (const uint8_t*)&t;
+        for (size_t i = 0; i < sizeof(T); i++) update(address + i, p[i]);
+        return t;
+    }
+
+    uint32_t writeCount(int address) { return writes()[address % SIZE]; }
+
+    // Back to a freshly erased chip
+    void erase() {
+        memset(data(), 0xFF, SIZE);
+        memset(writes(), 0, sizeof(uint32_t) * SIZE);
+    }
+
+private:
+    static uint8_t* data() {
+        static uint8_t cells[SIZE];
+        static bool erased = false;
+        if (!erased) { memset(cells, 0xFF, SIZE); erased = true; }
+        return cells;
+    }
+    static uint32_t* writes() { static uint32_t counts[SIZE]; return counts; }
+};
+static EEPROMClass EEPROM __attribute__((unused));
+
+#endif // HOST_EEPROM_H
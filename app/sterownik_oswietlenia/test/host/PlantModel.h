@@ -0,0 +1,170 @@
+#ifndef PLANT_MODEL_H
+#define PLANT_MODEL_H
+
+#include <Arduino.h>
+#include <math.h>
+#include "Constants.h"
+#include "Schedule.h"
+#include "EmiWindow.h"
+#include "FeedbackAdc.h"
+#include "OutputRegulator.h"
+
+// The 1-10V circuit as the controller sees it, for [env:native]. Include from exactly one
+// file per test program: it also provides FeedbackAdc (FeedbackAdc.cpp is left out of the
+// native build) and drives OutputRegulator::tick() the way Timer1 does.
+//
+// Driver stage, ballasts and lamps are one first-order lag on the PWM mean (inverted driver,
+// tau 80 ms). The feedback line reads 1 V + 9 V x (gain x lag + 2%), the gain dropping 5% per
+// lit tube from 0.95; the mask is taken from the relay pins. The ADC runs free at 9615 Hz and
+// sums ADC_WINDOW_SAMPLES samples per window, dropping windows that overlap a relay blackout
+// exactly as the ADC ISR does. Noise comes from a fixed-seed generator, so runs repeat.
+class PlantModel {
+public:
+    enum Fault {
+        NONE,
+        DEAD,        // feedback line at 0 V (open circuit, driver or divider gone)
+        STUCK,       // feedback frozen at its value when the fault hit
+        GAIN_HALVED  // half the ballasts stopped responding to the dimming input
+    };
+
+    float tauMs = 80.0f;
+    float offsetPercent = 2.0f;
+    float sampleNoiseCounts = 4.0f;  // uniform, +- per ADC sample
+    float windowNoisePercent = 0.0f; // uniform, +- of ADC full scale per window
+
+    // Seconds of simulated time; also advances millis()/micros()
+    void run(double seconds) { advance((unsigned long)(seconds * 1e6 + 0.5)); }
+
+    void advance(unsigned long us) {
+        if (!started) {
+            originUs = micros(); // ADC and Timer1 start with the first run, after any boot delay()
+            started = true;
+        }
+        unsigned long end = micros() - originUs + us;
+        for (;;) {
+            unsigned long now = micros() - originUs;
+            unsigned long next = min(nextSampleUs(), nextTickUs);
+            if (next > end) {
+                settle(end - now);
+                hostAdvanceMicros(end - now);
+                return;
+            }
+            settle(next - now);
+            hostAdvanceMicros(next - now);
+            if (next == nextSampleUs()) sample();
+            if (next == nextTickUs) {
+                OutputRegulator::tick();
+                nextTickUs += 1000000UL / REGULATOR_RATE_HZ;
+            }
+        }
+    }
+
+    void inject(Fault f) {
+        fault = f;
+        stuckCounts = feedbackCounts(false);
+    }
+
+    // Offsets the next window by 'percent' of ADC full scale (a mains spike, a missed glitch)
+    void spikeNextWindow(float percent) { spikePercent = percent; }
+
+    // Drive after the lag, 0-100%, and the gain the lit mask gives it
+    float light() const { return lag * 100.0f; }
+    float gain() const {
+        uint8_t tubes = (litMask() & BALLAST_1 ? 2 : 0) + (litMask() & BALLAST_2 ? 2 : 0) +
+                        (litMask() & BALLAST_3 ? 1 : 0);
+        return (fault == GAIN_HALVED ? 0.5f : 1.0f) * (0.95f - 0.05f * tubes);
+    }
+
+    // Feedback the line would settle at for a given output, %: what a learned map converges to
+    float settledFeedback(float outputPercent) const { return gain() * outputPercent + offsetPercent; }
+
+    // Output that settles at 'feedbackPercent' (ideal feedforward)
+    float outputFor(float feedbackPercent) const { return (feedbackPercent - offsetPercent) / gain(); }
+
+    static uint8_t litMask() {
+        // Relay coils are driven active-low
+        return (Ballast1RelayPin::read() ? 0 : BALLAST_1) |
+               (Ballast2RelayPin::read() ? 0 : BALLAST_2) |
+               (Ballast3RelayPin::read() ? 0 : BALLAST_3);
+    }
+
+    uint32_t windowSum = 0;   // last published window, as FeedbackAdc::windowSum()
+    uint8_t  windowSeq = 0;   // its sequence number, as FeedbackAdc::windowCount()
+
+private:
+    static const unsigned long ADC_RATE_HZ = 9615;
+
+    bool     started = false;
+    unsigned long originUs = 0;
+    float    lag = 0.0f;
+    unsigned long lastSettleUs = 0;
+    float    settleFactor = 0.0f;
+    Fault    fault = NONE;
+    float    stuckCounts = 0.0f;
+    float    spikePercent = 0.0f;
+    unsigned long samples = 0;
+    unsigned long nextTickUs = 1000000UL / REGULATOR_RATE_HZ;
+    uint32_t accumulator = 0;
+    uint8_t  inWindow = 0;
+    uint8_t  sequence = 0;
+    bool     tainted = false;
+    uint32_t noiseState = 12345;
+
+    unsigned long nextSampleUs() const { return (unsigned long)((samples + 1) * 1000000ULL / ADC_RATE_HZ); }
+
+    // Uniform in [-1, 1]
+    float noise() {
+        noiseState ^= noiseState << 13;
+        noiseState ^= noiseState >> 17;
+        noiseState ^= noiseState << 5;
+        return (noiseState & 0xFFFF) / 32767.5f - 1.0f;
+    }
+
+    void settle(unsigned long us) {
+        float drive = (ANALOG_WRITE_RESOLUTION - hostPin(VOLTAGE_OUTPUT_PIN).duty) / (float)ANALOG_WRITE_RESOLUTION;
+        if (us != lastSettleUs) { // mostly one ADC sample apart: reuse the factor
+            settleFactor = 1.0f - expf(-(us / 1000.0f) / tauMs);
+            lastSettleUs = us;
+        }
+        lag += (drive - lag) * settleFactor;
+    }
+
+    float feedbackCounts(bool faulted) const {
+        float volts = FEEDBACK_ZERO_VOLTS + FEEDBACK_SPAN_VOLTS * (gain() * lag + offsetPercent / 100.0f);
+        volts = min(volts, FEEDBACK_FULL_SCALE_VOLTS);
+        if (faulted && fault == DEAD) volts = 0.0f;
+        return volts / FEEDBACK_FULL_SCALE_VOLTS * ANALOG_READ_RESOLUTION;
+    }
+
+    void sample() {
+        samples++;
+        float counts = fault == STUCK ? stuckCounts : feedbackCounts(true);
+        counts = constrain(counts + sampleNoiseCounts * noise(), 0.0f, (float)ANALOG_READ_RESOLUTION);
+        accumulator += (uint16_t)(counts + 0.5f);
+        if (EmiWindow::blackout) tainted = true;
+        if (++inWindow < ADC_WINDOW_SAMPLES) return;
+
+        float extra = ADC_WINDOW_SAMPLES * ANALOG_READ_RESOLUTION / 100.0f *
+                      (windowNoisePercent * noise() + spikePercent);
+        spikePercent = 0.0f;
+        sequence++;
+        if (!tainted) {
+            windowSum = (uint32_t)max(0.0f, accumulator + extra);
+            windowSeq = sequence;
+        }
+        tainted = false;
+        accumulator = 0;
+        inWindow = 0;
+    }
+};
+
+PlantModel plant;
+
+void FeedbackAdc::begin() {}
+float FeedbackAdc::average() { return plant.windowSum / (float)ADC_WINDOW_SAMPLES; }
+uint32_t FeedbackAdc::windowSum() { return plant.windowSum; }
+uint8_t FeedbackAdc::windowCount() { return plant.windowSeq; }
+uint16_t FeedbackAdc::bandgapSum() { return 0; }
+uint8_t FeedbackAdc::bandgapCount() { return 0; } // supply taken as calibrated
+
+#endif // PLANT_MODEL_H
@@ -0,0 +1,26 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Empty TWI bus: nothing acknowledges, so only simulated devices answer on the host
+class TwoWire {
+public:
+    void begin() {}
+    void end() {}
+    void setClock(uint32_t) {}
+    void setWireTimeout(uint32_t = 25000, bool = false) {}
+    bool getWireTimeoutFlag() { return false; }
+    void clearWireTimeoutFlag() {}
+    void beginTransmission(uint8_t) {}
+    size_t write(uint8_t) { return 1; }
+    size_t write(const uint8_t*, size_t n) { return n; }
+    uint8_t endTransmission(bool = true) { return 2; } // address NACK
+    uint8_t requestFrom(uint8_t, uint8_t, uint8_t = 1) { return 0; }
+    int available() { return 0; }
+    int read() { return -1; }
+};
+static TwoWire Wire __attribute__((unused));
+
+#endif // HOST_WIRE_H
@@ -0,0 +1,133 @@
+#include <unity.h>
+#include "PlantModel.h"
+#include "AdcCalibration.h"
+#include "BallastModel.h"
+#include "FeedforwardMap.h"
+
+// AdcCalibration::fromPoints() on a feedback circuit 4% off the nominal divider with an 8-count
+// offset, and the rescale LightingController::applyCalibration() applies: every prediction the
+// mask models and the feedforward map make must stay the same window mean after it.
+// PlantModel only provides the ADC for the build.
+
+static AdcCalibration nominal;
+
+void setUp() {
+    EEPROM.erase();
+    nominal.setDefaults();
+}
+
+void tearDown() {}
+
+// Window mean of the circuit under test at 'volts' on the line
+static float countsAt(float volts) {
+    return 8.0f + 1.04f * volts / FEEDBACK_FULL_SCALE_VOLTS * ANALOG_READ_RESOLUTION;
+}
+
+static float countsFor(const AdcCalibration& cal, float percent) {
+    return cal.zeroCounts + percent / 100.0f * (cal.fullCounts - cal.zeroCounts);
+}
+
+void test_two_points_extrapolate_to_1_and_10_volts() {
+    AdcCalibration cal = nominal;
+    TEST_ASSERT_TRUE(cal.fromPoints(countsAt(2.5f), 2.5f, countsAt(8.0f), 8.0f));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, countsAt(FEEDBACK_ZERO_VOLTS), cal.zeroCounts);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, countsAt(FEEDBACK_ZERO_VOLTS + FEEDBACK_SPAN_VOLTS), cal.fullCounts);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 50.0f, cal.percentFor(countsAt(5.5f)));
+
+    // Either order
+    AdcCalibration reversed = nominal;
+    TEST_ASSERT_TRUE(reversed.fromPoints(countsAt(8.0f), 8.0f, countsAt(2.5f), 2.5f));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, cal.zeroCounts, reversed.zeroCounts);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, cal.fullCounts, reversed.fullCounts);
+}
+
+// Points too close together, or a line nothing like the circuit (swapped readings, a dead
+// input), leave the calibration as it was
+void test_bad_points_are_rejected() {
+    AdcCalibration cal = nominal;
+    TEST_ASSERT_FALSE(cal.fromPoints(countsAt(4.0f), 4.0f, countsAt(6.5f), 6.5f));
+    TEST_ASSERT_FALSE(cal.fromPoints(countsAt(8.0f), 2.5f, countsAt(2.5f), 8.0f));
+    TEST_ASSERT_FALSE(cal.fromPoints(0.0f, 2.5f, 0.0f, 8.0f));
+    TEST_ASSERT_EQUAL_MEMORY(&nominal, &cal, sizeof(cal));
+}
+
+void test_calibration_survives_reload_and_corruption_falls_back() {
+    AdcCalibration cal = nominal;
+    TEST_ASSERT_TRUE(cal.fromPoints(countsAt(2.5f), 2.5f, countsAt(8.0f), 8.0f));
+    cal.save();
+    AdcCalibration loaded;
+    loaded.load();
+    TEST_ASSERT_EQUAL_FLOAT(cal.zeroCounts, loaded.zeroCounts);
+    TEST_ASSERT_EQUAL_FLOAT(cal.fullCounts, loaded.fullCounts);
+
+    EEPROM.write(EEPROM_ADC_CAL_ADDR + 1, EEPROM.read(EEPROM_ADC_CAL_ADDR + 1) ^ 0x01);
+    loaded.load();
+    TEST_ASSERT_EQUAL_FLOAT(nominal.zeroCounts, loaded.zeroCounts);
+    TEST_ASSERT_EQUAL_FLOAT(nominal.fullCounts, loaded.fullCounts);
+}
+
+// Models and map learned on the nominal scale, then the circuit is calibrated: each output
+// must still predict the same window mean, and each window mean the same output
+void test_recalibration_keeps_every_prediction() {
+    BallastModel model;
+    model.load(); // defaults
+    FeedforwardMap map;
+    map.setDefaults();
+    for (uint8_t mask = 1; mask <= BallastModel::MASKS; mask++) {
+        float gain = 0.95f - 0.04f * mask;
+        for (float output = 20.0f; output <= 80.0f; output += 5.0f) model.learn(mask, output, gain * output + 2.0f);
+    }
+    for (uint8_t i = 0; i < 50; i++) {
+        float output = 10.0f + 80.0f * ((i * 7) % 50) / 50.0f;
+        map.learn(output, 0.85f * output + 2.0f);
+    }
+
+    float outputs[] = {10.0f, 30.0f, 50.0f, 70.0f, 90.0f};
+    float modelCounts[BallastModel::MASKS][5], mapCounts[5];
+    for (uint8_t k = 0; k < 5; k++) {
+        for (uint8_t mask = 1; mask <= BallastModel::MASKS; mask++) {
+            modelCounts[mask - 1][k] = countsFor(nominal, model.feedbackFor(mask, outputs[k]));
+        }
+        mapCounts[k] = countsFor(nominal, map.feedbackFor(outputs[k]));
+    }
+
+    // As LightingController::calibrateFeedback() -> applyCalibration()
+    AdcCalibration cal = nominal;
+    TEST_ASSERT_TRUE(cal.fromPoints(countsAt(2.5f), 2.5f, countsAt(8.0f), 8.0f));
+    float scale, shift;
+    cal.rescaleFrom(nominal, scale, shift);
+    model.rescaleFeedback(scale, shift);
+    map.rescaleFeedback(scale, shift);
+
+    for (uint8_t k = 0; k < 5; k++) {
+        for (uint8_t mask = 1; mask <= BallastModel::MASKS; mask++) {
+            float counts = modelCounts[mask - 1][k];
+            TEST_ASSERT_FLOAT_WITHIN(0.01f, counts, countsFor(cal, model.feedbackFor(mask, outputs[k])));
+            TEST_ASSERT_FLOAT_WITHIN(0.01f, outputs[k], model.outputFor(mask, cal.percentFor(counts)));
+        }
+        // The map holds centi-percent points: 0.005% of the span, ~0.05 counts
+        TEST_ASSERT_FLOAT_WITHIN(0.1f, mapCounts[k], countsFor(cal, map.feedbackFor(outputs[k])));
+        TEST_ASSERT_FLOAT_WITHIN(0.02f, outputs[k], map.outputFor(cal.percentFor(mapCounts[k])));
+    }
+}
+
+// Back to the defaults (the "cal reset" command) undoes it
+void test_reset_rescales_back() {
+    AdcCalibration cal = nominal;
+    TEST_ASSERT_TRUE(cal.fromPoints(countsAt(2.5f), 2.5f, countsAt(8.0f), 8.0f));
+    float scale, shift, backScale, backShift;
+    cal.rescaleFrom(nominal, scale, shift);
+    nominal.rescaleFrom(cal, backScale, backShift);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.0f, scale * backScale);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.0f, backScale * shift + backShift);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_two_points_extrapolate_to_1_and_10_volts);
+    RUN_TEST(test_bad_points_are_rejected);
+    RUN_TEST(test_calibration_survives_reload_and_corruption_falls_back);
+    RUN_TEST(test_recalibration_keeps_every_prediction);
+    RUN_TEST(test_reset_rescales_back);
+    return UNITY_END();
+}
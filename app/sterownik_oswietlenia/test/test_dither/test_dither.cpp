@@ -0,0 +1,61 @@
+#include <unity.h>
+#include "PlantModel.h"
+#include "OutputRegulator.h"
+
+// Output resolution after the plant's lag with the sigma-delta dither (PWM_DITHER_BITS).
+// The regulator holds a fixed output; the lag stands in for the 1-10V RC filter and the
+// ballasts, which see the mean of the alternating duties.
+
+static const float LSB = 100.0f / (ANALOG_WRITE_RESOLUTION << PWM_DITHER_BITS); // one dithered step, %
+
+static char message[120];
+
+void setUp() {}
+void tearDown() {}
+
+// Mean and peak-to-peak of the light over 16 dither patterns, once the lag has settled
+static float heldLight(float outputPercent, float& ripple) {
+    OutputRegulator::setOutputPercent(outputPercent);
+    plant.run(0.5);
+    float sum = 0.0f, lowest = 100.0f, highest = 0.0f;
+    for (int i = 0; i < 16 << PWM_DITHER_BITS; i++) {
+        plant.advance(1000000UL / REGULATOR_RATE_HZ);
+        sum += plant.light();
+        lowest = min(lowest, plant.light());
+        highest = max(highest, plant.light());
+    }
+    ripple = highest - lowest;
+    return sum / (16 << PWM_DITHER_BITS);
+}
+
+// Every dithered step between 4% and 6% - around MIN_WARM_PER_TUBE_POWER, where the 8-bit grid
+// had a dozen steps - must land on its own level, one step above the last
+void test_low_end_resolves_every_dithered_step() {
+    int first = (int)ceil(4.0f / LSB), last = (int)(6.0f / LSB);
+    float previous = -1.0f, worstError = 0.0f, smallestStep = 100.0f, largestStep = 0.0f, worstRipple = 0.0f;
+    for (int code = first; code <= last; code++) {
+        float ripple;
+        float light = heldLight((code + 0.5f) * LSB, ripple); // mid-step, clear of float rounding
+        worstError = max(worstError, fabsf(light - code * LSB));
+        worstRipple = max(worstRipple, ripple);
+        if (code > first) {
+            smallestStep = min(smallestStep, light - previous);
+            largestStep = max(largestStep, light - previous);
+        }
+        previous = light;
+    }
+
+    snprintf(message, sizeof(message), "%d steps 4-6%%: step %.2f-%.2f LSB, error %.2f LSB, ripple %.2f LSB pp, %.1f bits",
+             last - first, smallestStep / LSB, largestStep / LSB, worstError / LSB, worstRipple / LSB,
+             log(100.0f / LSB) / log(2.0f));
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE_MESSAGE(smallestStep > 0.5f * LSB && largestStep < 1.5f * LSB, "missing or doubled steps");
+    TEST_ASSERT_TRUE_MESSAGE(worstError < LSB, "held level off by a step or more");
+    TEST_ASSERT_TRUE_MESSAGE(worstRipple < 2.0f * LSB, "dither ripple gets through the lag");
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_low_end_resolves_every_dithered_step);
+    return UNITY_END();
+}
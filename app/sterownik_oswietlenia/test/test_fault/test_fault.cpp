@@ -0,0 +1,111 @@
+#include <unity.h>
+#include "ControllerRig.h"
+
+// FaultDetector inside the full controller on the plant model: no alarm over a noisy day,
+// fast latching of real faults, none on a single wild window. Each test boots on an erased
+// EEPROM, so the masks start untrained (FAULT_CUSUM_DRIFT_UNTRAINED) and learn as they run.
+
+static ControllerRig rig;
+static char message[120];
+
+void setUp() {
+    rig.powerOn();
+}
+
+void tearDown() {}
+
+// Runs the main loop for 'seconds'; false once a fault latches, with the seconds it took in
+// 'latchedAfter'
+static bool runFor(double seconds, float& peakCusum, double& latchedAfter) {
+    bool clean = rig.run(seconds, [&] {
+        const FaultDetector& f = rig.lighting->getFaultDetector();
+        peakCusum = max(peakCusum, max(f.high, f.low));
+        return rig.lighting->isSystemInFault();
+    });
+    if (!clean) latchedAfter = rig.elapsed;
+    return clean;
+}
+
+// Same, starting the local clock at 'fromSecond' of the day
+static bool runFrom(long fromSecond, double seconds, float& peakCusum, double& latchedAfter) {
+    rig.setClock(fromSecond);
+    return runFor(seconds, peakCusum, latchedAfter);
+}
+
+// Lights on and the regulator settled by 08:28, in the morning ramp
+static void warmUp() {
+    float peak = 0.0f;
+    double latched = 0.0;
+    TEST_ASSERT_TRUE_MESSAGE(runFrom(8 * 3600L - 300, 2000.0, peak, latched), "fault before injection");
+    TEST_ASSERT_TRUE_MESSAGE(PlantModel::litMask() != 0, "lights not on at 08:28");
+}
+
+static double latency(PlantModel::Fault fault, double limit) {
+    warmUp();
+    plant.inject(fault);
+    float peak = 0.0f;
+    double latched = limit;
+    runFor(limit, peak, latched);
+    return latched;
+}
+
+// Whole schedule with +-2% window noise on top of the per-sample noise
+void test_no_false_alarm_over_a_noisy_day() {
+    plant.windowNoisePercent = 2.0f;
+    float peak = 0.0f;
+    double latched = 0.0;
+    bool clean = runFrom(8 * 3600L - 300, 12 * 3600.0 + 600.0, peak, latched);
+    snprintf(message, sizeof(message), "12 h, %.0f windows: peak CUSUM %.1f of %.0f, %s",
+             (12 * 3600.0 + 600.0) * 1000.0 / ADC_WINDOW_MS, peak, FAULT_CUSUM_LIMIT,
+             clean ? "no alarm" : "ALARM");
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE_MESSAGE(clean, "false alarm");
+}
+
+void test_dead_circuit_latches_within_250ms() {
+    double s = latency(PlantModel::DEAD, 5.0);
+    snprintf(message, sizeof(message), "dead circuit latched after %.0f ms", s * 1000.0);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE_MESSAGE(s < 0.25, "dead circuit latched too late");
+}
+
+void test_gain_collapse_latches_within_250ms() {
+    double s = latency(PlantModel::GAIN_HALVED, 5.0);
+    snprintf(message, sizeof(message), "halved gain latched after %.0f ms", s * 1000.0);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE_MESSAGE(s < 0.25, "halved gain latched too late");
+}
+
+// Only visible while the output moves: the morning ramp has to carry it past the drift
+void test_stuck_feedback_latches_on_the_ramp() {
+    double s = latency(PlantModel::STUCK, 120.0);
+    snprintf(message, sizeof(message), "stuck feedback latched after %.1f s", s);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE_MESSAGE(s < 60.0, "stuck feedback latched too late");
+}
+
+// One window 40%, later one 90% low fill the CUSUM but not the run of FAULT_PERSIST_WINDOWS
+void test_single_wild_window_does_not_latch() {
+    warmUp();
+    float peak = 0.0f;
+    double latched = 0.0;
+    plant.spikeNextWindow(-40.0f);
+    bool clean = runFor(5.0, peak, latched);
+    float peak40 = peak;
+    plant.spikeNextWindow(-90.0f);
+    clean = clean && runFor(5.0, peak, latched);
+    snprintf(message, sizeof(message), "40%% and 90%% spikes: peak CUSUM %.0f and %.0f, %s",
+             peak40, peak, clean ? "no alarm" : "ALARM");
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE_MESSAGE(clean, "a single window latched a fault");
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_no_false_alarm_over_a_noisy_day);
+    RUN_TEST(test_dead_circuit_latches_within_250ms);
+    RUN_TEST(test_gain_collapse_latches_within_250ms);
+    RUN_TEST(test_stuck_feedback_latches_on_the_ramp);
+    RUN_TEST(test_single_wild_window_does_not_latch);
+    return UNITY_END();
+}
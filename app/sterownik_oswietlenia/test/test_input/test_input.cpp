@@ -0,0 +1,101 @@
+#include <unity.h>
+#include "PlantModel.h"
+#include "InputManager.h"
+
+// Button debouncing on FakePin levels, with the PCINT0 ISR called by hand at each edge.
+// PlantModel only provides the ADC for the build.
+
+static InputManager input;
+
+static void edge(bool down) {
+    ButtonSetPin::write(down); // active HIGH
+    InputManager::isr();
+}
+
+static void waitMs(unsigned long ms) { hostAdvanceMicros(ms * 1000UL); }
+
+static void assertNoEvent() {
+    ButtonAction a = input.next();
+    TEST_ASSERT_EQUAL(EVENT_NONE, a.event);
+}
+
+static void assertPress() {
+    ButtonAction a = input.next();
+    TEST_ASSERT_EQUAL(BTN_SET, a.button);
+    TEST_ASSERT_EQUAL(EVENT_PRESS, a.event);
+}
+
+void setUp() {
+    input.begin();
+    edge(false);
+    waitMs(1000);
+    while (input.next().event != EVENT_NONE) {}
+}
+
+void tearDown() {}
+
+void test_bounced_press_is_one_press() {
+    for (int i = 0; i < 3; i++) {
+        edge(true);
+        hostAdvanceMicros(700);
+        edge(false);
+        hostAdvanceMicros(900);
+    }
+    edge(true);
+    waitMs(BUTTON_DEBOUNCE_DELAY - 10);
+    assertNoEvent();
+    waitMs(20);
+    assertPress();
+    assertNoEvent();
+}
+
+// A relay-coupled spike of a few microseconds is not a press
+void test_spike_is_not_a_press() {
+    edge(true);
+    hostAdvanceMicros(20);
+    edge(false);
+    waitMs(200);
+    assertNoEvent();
+}
+
+// Press and release both confirmed by the ISR while loop() is busy elsewhere
+void test_tap_during_a_long_operation_is_kept() {
+    edge(true);
+    waitMs(120);
+    edge(false);
+    waitMs(300);
+    assertPress();
+    assertNoEvent();
+}
+
+void test_edges_in_an_emi_window_are_dropped() {
+    EmiWindow::announce();
+    edge(true);
+    waitMs(100);
+    assertNoEvent();
+    edge(false);
+    waitMs(EMI_WINDOW_MS);
+    EmiWindow::update();
+    waitMs(100);
+    assertNoEvent();
+}
+
+void test_held_button_repeats() {
+    edge(true);
+    waitMs(BUTTON_DEBOUNCE_DELAY + 10);
+    assertPress();
+    waitMs(LONG_PRESS_DELAY + 10);
+    ButtonAction a = input.next();
+    TEST_ASSERT_EQUAL(EVENT_HOLD, a.event);
+    edge(false);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_bounced_press_is_one_press);
+    RUN_TEST(test_spike_is_not_a_press);
+    RUN_TEST(test_tap_during_a_long_operation_is_kept);
+    RUN_TEST(test_edges_in_an_emi_window_are_dropped);
+    RUN_TEST(test_held_button_repeats);
+    return UNITY_END();
+}
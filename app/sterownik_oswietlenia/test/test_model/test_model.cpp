@@ -0,0 +1,138 @@
+#include <unity.h>
+#include "PlantModel.h"
+#include "OutputRegulator.h"
+#include "AdcCalibration.h"
+#include "BallastModel.h"
+
+// BallastModel fitted on the plant model (gain 0.95 - 0.05 per lit tube, offset 2%, tau 80 ms),
+// fed the way LightingController feeds it: settled (output, feedback) samples spread along the
+// output range, and tau from consecutive feedback windows while the feedback is still moving.
+
+static BallastModel model;
+static char message[120];
+
+void setUp() {
+    EEPROM.erase();
+    model.load(); // every entry invalid: defaults
+
+    AdcCalibration cal;
+    cal.setDefaults();
+    OutputRegulator::setFeedbackScale(cal.zeroCounts, cal.fullCounts, 1.0f);
+    OutputRegulator::begin();
+}
+
+void tearDown() {}
+
+static void light(uint8_t mask) {
+    // Relay coils are driven active-low
+    if (mask & BALLAST_1) Ballast1RelayPin::low(); else Ballast1RelayPin::high();
+    if (mask & BALLAST_2) Ballast2RelayPin::low(); else Ballast2RelayPin::high();
+    if (mask & BALLAST_3) Ballast3RelayPin::low(); else Ballast3RelayPin::high();
+}
+
+// One window per call, fed to learnDynamics() as LightingController::observeFeedback() does
+// (three consecutive windows; a gap in the sequence starts over)
+struct DynamicsFeed {
+    uint8_t window = 0, history = 0;
+    float   output = 0.0f, feedback = 0.0f, outputStep = 0.0f, feedbackStep = 0.0f;
+
+    void run(uint8_t mask, float seconds) {
+        for (float t = 0.0f; t < seconds; t += 1.0f / REGULATOR_RATE_HZ) {
+            plant.advance(1000000UL / REGULATOR_RATE_HZ);
+            float now;
+            uint8_t w = OutputRegulator::readFeedback(now);
+            if (w == window) continue;
+            history = (uint8_t)(w - window) == 1 ? min(history + 1, 2) : 0;
+            window = w;
+
+            float out = OutputRegulator::getOutputPercent();
+            float step = now - feedback;
+            if (history == 2 && model.trained(mask)) model.learnDynamics(mask, outputStep, feedbackStep, step);
+            outputStep = out - output;
+            feedbackStep = step;
+            output = out;
+            feedback = now;
+        }
+    }
+};
+
+// Regulated sweep 20% -> 70% feedback (in reach on every mask) and back in 5% steps, 3 s each, one settled sample per target
+// (MODEL_SAMPLE_SPACING apart); the feedforward is a flat 1:1 guess until the mask is trained.
+// Then open-loop output jumps between about 20% and 70%, held 1 s - the first-order response tau
+// is read from, as after the output seed on a relay switch.
+static void train(uint8_t mask) {
+    light(mask);
+    OutputRegulator::setOutputPercent(20.0f);
+    DynamicsFeed feed;
+
+    for (uint8_t pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < 20; i++) {
+            float target = 20.0f + 5.0f * (i <= 10 ? i : 20 - i);
+            float feedforward = model.trained(mask) ? model.outputFor(mask, target) : target;
+            OutputRegulator::set(target, feedforward, false);
+            feed.run(mask, 3.0f);
+
+            float feedback = OutputRegulator::getFeedbackPercent();
+            TEST_ASSERT_TRUE(fabsf(feedback - target) < FF_LEARN_MAX_ERROR);
+            model.learn(mask, OutputRegulator::getOutputPercent(), feedback);
+        }
+    }
+
+    for (uint8_t i = 0; i < 40; i++) {
+        float output = 20.0f + 50.0f * (i % 2) + 2.0f * (i % 5);
+        OutputRegulator::setOutputPercent(output);
+        OutputRegulator::set(0.0f, output, true);
+        feed.run(mask, 1.0f);
+    }
+}
+
+void test_fit_converges_on_every_mask() {
+    for (uint8_t mask = 1; mask <= BallastModel::MASKS; mask++) {
+        train(mask);
+        const BallastModel::Entry& e = model.entries[mask - 1];
+        snprintf(message, sizeof(message), "mask %u: gain %.3f (plant %.3f), offset %.2f%%, tau %u ms",
+                 mask, e.gain, plant.gain(), e.offset, e.tauMs);
+        TEST_MESSAGE(message);
+
+        TEST_ASSERT_TRUE(model.trained(mask));
+        TEST_ASSERT_FLOAT_WITHIN(0.005f, plant.gain(), e.gain);
+        TEST_ASSERT_FLOAT_WITHIN(0.1f, plant.offsetPercent, e.offset);
+        TEST_ASSERT_FLOAT_WITHIN(10.0f, plant.tauMs, e.tauMs);
+    }
+}
+
+// Each entry has its own checksum: a flipped byte in one resets that mask alone
+void test_corrupt_entry_resets_only_its_mask() {
+    for (uint8_t mask = 1; mask <= BallastModel::MASKS; mask++) {
+        float outputs[] = {20.0f, 50.0f, 80.0f}, feedbacks[3], linearity;
+        for (uint8_t i = 0; i < 3; i++) feedbacks[i] = (0.8f + mask / 100.0f) * outputs[i] + 2.0f;
+        model.calibrate(mask, outputs, feedbacks, 3, 70.0f + mask, linearity);
+    }
+    model.save();
+
+    const uint8_t corrupt = 3;
+    int address = EEPROM_BALLAST_MODEL_ADDR + (corrupt - 1) * sizeof(BallastModel::Entry) + 4;
+    EEPROM.write(address, EEPROM.read(address) ^ 0x10);
+
+    BallastModel loaded;
+    loaded.load();
+    for (uint8_t mask = 1; mask <= BallastModel::MASKS; mask++) {
+        const BallastModel::Entry& e = loaded.entries[mask - 1];
+        if (mask == corrupt) {
+            TEST_ASSERT_FALSE(loaded.trained(mask));
+            TEST_ASSERT_EQUAL_FLOAT(1.0f, e.gain);
+            TEST_ASSERT_EQUAL_FLOAT(0.0f, e.offset);
+            TEST_ASSERT_EQUAL(MODEL_DEFAULT_TAU_MS, e.tauMs);
+        } else {
+            TEST_ASSERT_TRUE(loaded.trained(mask));
+            TEST_ASSERT_EQUAL_MEMORY(&model.entries[mask - 1], &e, sizeof(e));
+        }
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_fit_converges_on_every_mask);
+    RUN_TEST(test_corrupt_entry_resets_only_its_mask);
+    return UNITY_END();
+}
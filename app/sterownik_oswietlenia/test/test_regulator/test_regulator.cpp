@@ -0,0 +1,104 @@
+#include <unity.h>
+#include "PlantModel.h"
+#include "OutputRegulator.h"
+#include "AdcCalibration.h"
+
+// Settling of the PI regulator with feedforward on the plant model, B1 lit (gain 0.85).
+// Settled = feedback within SETTLE_BAND of the target from then on.
+
+static const float SETTLE_BAND = 0.5f;
+static const float TICK_S = 1.0f / REGULATOR_RATE_HZ;
+
+static char message[120];
+
+struct StepResult {
+    float settleS;
+    float overshoot; // past the target, % feedback
+};
+
+void setUp() {
+    Ballast1RelayPin::low(); // relays are active-low
+    Ballast2RelayPin::high();
+    Ballast3RelayPin::high();
+
+    AdcCalibration cal;
+    cal.setDefaults();
+    OutputRegulator::setFeedbackScale(cal.zeroCounts, cal.fullCounts, 1.0f);
+    OutputRegulator::begin();
+}
+
+void tearDown() {}
+
+// Holds 'from' until settled, then steps to 'to' with the feedforward off by 'feedforwardError'
+// (fraction of the ideal output - a map that has not learned the mask yet)
+static StepResult step(float from, float to, float feedforwardError) {
+    OutputRegulator::setOutputPercent(plant.outputFor(from));
+    OutputRegulator::set(from, plant.outputFor(from), false);
+    plant.run(3.0);
+
+    OutputRegulator::set(to, plant.outputFor(to) * (1.0f + feedforwardError), false);
+    StepResult r = {0.0f, 0.0f};
+    for (float t = TICK_S; t < 10.0f; t += TICK_S) {
+        plant.advance(1000000UL / REGULATOR_RATE_HZ);
+        float feedback = OutputRegulator::getFeedbackPercent();
+        if (fabsf(feedback - to) > SETTLE_BAND) r.settleS = t;
+        r.overshoot = max(r.overshoot, to > from ? feedback - to : to - feedback);
+    }
+    return r;
+}
+
+static void report(const char* name, const StepResult& r) {
+    snprintf(message, sizeof(message), "%s: settled to +-%.1f%% in %.2f s, overshoot %.2f%%",
+             name, SETTLE_BAND, r.settleS, r.overshoot);
+    TEST_MESSAGE(message);
+}
+
+// Bounded by the MAX_VOLTAGE_STEP slew: 30% feedback is ~35% output, 1.8 s at 20%/s
+void test_large_step_settles_at_the_slew_limit() {
+    StepResult r = step(20.0f, 50.0f, 0.0f);
+    report("20->50%", r);
+    TEST_ASSERT_TRUE_MESSAGE(r.settleS < 2.5f, "large step too slow");
+    TEST_ASSERT_TRUE_MESSAGE(r.overshoot < SETTLE_BAND, "large step overshoots");
+}
+
+void test_small_step_settles_fast() {
+    StepResult r = step(40.0f, 42.0f, 0.0f);
+    report("40->42%", r);
+    TEST_ASSERT_TRUE_MESSAGE(r.settleS < 0.5f, "small step too slow");
+    TEST_ASSERT_TRUE_MESSAGE(r.overshoot < SETTLE_BAND, "small step overshoots");
+}
+
+// Feedforward 10% off, as from a map that has not learned the mask yet: PI closes the gap
+void test_unlearned_feedforward_settles() {
+    StepResult r = step(40.0f, 42.0f, 0.1f);
+    report("40->42%, feedforward +10%", r);
+    TEST_ASSERT_TRUE_MESSAGE(r.settleS < 2.0f, "unlearned feedforward settles too slowly");
+    TEST_ASSERT_TRUE_MESSAGE(r.overshoot < 2.0f * SETTLE_BAND, "unlearned feedforward overshoots");
+}
+
+// Dawn/dusk-like 1%/s ramp: tracking error once the ramp is under way
+void test_ramp_is_tracked() {
+    OutputRegulator::setOutputPercent(plant.outputFor(30.0f));
+    OutputRegulator::set(30.0f, plant.outputFor(30.0f), false);
+    plant.run(3.0);
+
+    float worst = 0.0f;
+    for (float t = TICK_S; t < 10.0f; t += TICK_S) {
+        float target = 30.0f + t;
+        OutputRegulator::set(target, plant.outputFor(target), false);
+        plant.advance(1000000UL / REGULATOR_RATE_HZ);
+        if (t > 1.0f) worst = max(worst, fabsf(OutputRegulator::getFeedbackPercent() - target));
+    }
+    snprintf(message, sizeof(message), "1%%/s ramp: worst tracking error %.3f%%", worst);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE_MESSAGE(worst < 0.2f, "ramp lags");
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_large_step_settles_at_the_slew_limit);
+    RUN_TEST(test_small_step_settles_fast);
+    RUN_TEST(test_unlearned_feedforward_settles);
+    RUN_TEST(test_ramp_is_tracked);
+    return UNITY_END();
+}
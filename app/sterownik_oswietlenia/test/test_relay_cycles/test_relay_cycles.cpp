@@ -0,0 +1,58 @@
+#include <unity.h>
+#include "ControllerRig.h"
+
+// Relay energise cycles (getRelayCycles: transformer, B1-B3) over a whole 08:00-20:00 day on
+// the plant model, with and without ten minutes of override toggled between 0% and 40% every
+// 20 s from 08:55 - the chatter MASK_HYSTERESIS_POWER and the minimum dwell exist to limit.
+
+static ControllerRig rig;
+static char message[120];
+
+void setUp() {
+    rig.powerOn();
+    rig.setClock(8 * 3600L - 300);
+}
+
+void tearDown() {}
+
+static void runDay(bool toggleOverride) {
+    const double toggleFrom = 3600.0, toggleFor = 600.0;
+    double t = 0.0;
+    rig.run(12 * 3600.0 + 600.0, [&] {
+        t += ControllerRig::LOOP_US / 1e6;
+        bool toggling = toggleOverride && t >= toggleFrom && t < toggleFrom + toggleFor;
+        rig.lighting->overrideEnabled = toggling;
+        if (toggling) rig.lighting->overridePowerPercent = ((long)(t / 20.0) % 2) ? 40 : 0;
+        return false;
+    });
+
+    snprintf(message, sizeof(message), "%s: T %u B1 %u B2 %u B3 %u", toggleOverride ? "with override" : "schedule only",
+             rig.lighting->getRelayCycles(0), rig.lighting->getRelayCycles(1),
+             rig.lighting->getRelayCycles(2), rig.lighting->getRelayCycles(3));
+    TEST_MESSAGE(message);
+}
+
+void test_schedule_cycles_each_relay_at_most_twice() {
+    runDay(false);
+    TEST_ASSERT_EQUAL(2, rig.lighting->getRelayCycles(0));
+    TEST_ASSERT_EQUAL(2, rig.lighting->getRelayCycles(1));
+    TEST_ASSERT_EQUAL(1, rig.lighting->getRelayCycles(2));
+    TEST_ASSERT_EQUAL(2, rig.lighting->getRelayCycles(3));
+}
+
+// 30 toggles in 10 minutes: the dwell limits each ballast to one cycle per
+// BALLAST_MIN_ON_MS + BALLAST_MIN_OFF_MS (90 s) on top of the schedule's own
+void test_override_toggling_is_dwell_limited() {
+    runDay(true);
+    TEST_ASSERT_EQUAL(2, rig.lighting->getRelayCycles(0));
+    TEST_ASSERT_EQUAL(8, rig.lighting->getRelayCycles(1));
+    TEST_ASSERT_EQUAL(7, rig.lighting->getRelayCycles(2));
+    TEST_ASSERT_EQUAL(8, rig.lighting->getRelayCycles(3));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_schedule_cycles_each_relay_at_most_twice);
+    RUN_TEST(test_override_toggling_is_dwell_limited);
+    return UNITY_END();
+}
@@ -0,0 +1,149 @@
+#include <unity.h>
+#include "ControllerRig.h"
+
+// Boot-time checkpoint handling of TimeController on the simulated DS3231, whose checkpoint
+// lives in the EEPROM ring (EepromScratch), and the lit-state resume it allows after a reset.
+
+static const time_t NOON = 1767614400; // 2026-01-05 12:00 UTC
+
+static ControllerRig rig;
+static SimulatedDs3231& rtc = rig.rtc;
+static char message[120];
+
+void setUp() {
+    EEPROM.erase();
+    rtc = SimulatedDs3231();
+}
+
+void tearDown() {}
+
+// Boots a TimeController on the running clock and stores a lit checkpoint
+static Checkpoint saveLitCheckpoint() {
+    TimeController time(rtc);
+    time.begin();
+    Checkpoint cp;
+    cp.ballastMask = BALLAST_1 | BALLAST_3;
+    cp.rotationDay = 4;
+    TEST_ASSERT_TRUE(time.saveCheckpoint(cp));
+    return cp;
+}
+
+void test_first_boot_reports_power_loss() {
+    TimeController time(rtc);
+    time.begin();
+    Checkpoint cp;
+    TEST_ASSERT_TRUE(time.rtcPowerLost);
+    TEST_ASSERT_FALSE(time.getCheckpoint(cp));
+}
+
+void test_checkpoint_survives_a_reset() {
+    rtc.writeTime(NOON);
+    Checkpoint saved = saveLitCheckpoint();
+    delay(5000);
+
+    TimeController time(rtc);
+    time.begin();
+    Checkpoint cp;
+    TEST_ASSERT_TRUE(time.getCheckpoint(cp));
+    TEST_ASSERT_EQUAL_MEMORY(&saved, &cp, sizeof(cp));
+    TEST_ASSERT_FALSE(time.rtcPowerLost);
+    TEST_ASSERT_TRUE(time.bootQuorumReached);
+    TEST_ASSERT_TRUE(now() >= NOON + 5 && now() <= NOON + 6);
+}
+
+// The RTC restarted an hour back: time resumes from the checkpoint and is flagged suspect
+void test_rtc_behind_the_checkpoint_is_overruled() {
+    rtc.writeTime(NOON);
+    saveLitCheckpoint();
+    rtc.writeTime(NOON - 3600);
+
+    TimeController time(rtc);
+    time.begin();
+    TEST_ASSERT_TRUE(time.rtcPowerLost);
+    TEST_ASSERT_TRUE(now() >= NOON && now() <= NOON + 1);
+}
+
+// A checkpoint extrapolated from millis() may lead the RTC by up to CHECKPOINT_CLOCK_TOLERANCE_S
+void test_rtc_slightly_behind_the_checkpoint_is_trusted() {
+    rtc.writeTime(NOON);
+    saveLitCheckpoint();
+    rtc.writeTime(NOON - (CHECKPOINT_CLOCK_TOLERANCE_S - 2));
+
+    TimeController time(rtc);
+    time.begin();
+    TEST_ASSERT_FALSE(time.rtcPowerLost);
+    TEST_ASSERT_TRUE(time.bootQuorumReached);
+    TEST_ASSERT_TRUE(now() < NOON);
+}
+
+// A checkpoint a minute for a simulated 100 days: the newest always reads back, and no EEPROM
+// cell takes more than its share of the writes
+void test_checkpoint_ring_spreads_wear() {
+    rtc.writeTime(NOON);
+    TimeController time(rtc);
+    time.begin();
+
+    const unsigned long saves = 100UL * 24 * 60;
+    Checkpoint cp = {};
+    for (unsigned long i = 0; i < saves; i++) {
+        cp.rotationDay = (int16_t)i;
+        TEST_ASSERT_TRUE(time.saveCheckpoint(cp));
+        Checkpoint back;
+        rtc.readScratch((uint8_t*)&back, sizeof(back));
+        TEST_ASSERT_EQUAL_MEMORY(&cp, &back, sizeof(cp));
+        delay(60000);
+    }
+
+    uint32_t worst = 0;
+    for (int a = 0; a < EEPROMClass::SIZE; a++) worst = max(worst, EEPROM.writeCount(a));
+    snprintf(message, sizeof(message), "%lu checkpoints: at most %lu writes to one cell (%u slots)",
+             saves, (unsigned long)worst, EEPROM_SCRATCH_SLOTS);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(worst <= saves / EEPROM_SCRATCH_SLOTS + 1);
+}
+
+// Lit at 08:28, then a reset 'afterWrite' seconds after the newest checkpoint, dark for
+// 'outage' seconds
+static Checkpoint resetAfterCheckpoint(double afterWrite, double outage) {
+    rig.powerOn();
+    rig.setClock(8 * 3600L - 300);
+    rig.run(2000.0);
+    TEST_ASSERT_TRUE_MESSAGE(PlantModel::litMask() != 0, "lights not on at 08:28");
+
+    Checkpoint last, cp;
+    TEST_ASSERT_TRUE(rig.time->getCheckpoint(last));
+    rig.run(CHECKPOINT_INTERVAL_MS / 1000.0 + 1.0, [&] {
+        rig.time->getCheckpoint(cp);
+        return cp.utc != last.utc;
+    });
+    rig.run(afterWrite);
+    rig.reset(outage);
+    return cp;
+}
+
+// Checkpoints are a minute apart: a reset late in the interval must still resume
+void test_reset_45s_after_a_checkpoint_resumes() {
+    Checkpoint cp = resetAfterCheckpoint(45.0, 0.0);
+    TEST_ASSERT_TRUE_MESSAGE(rig.lighting->resumedFromCheckpoint, "checkpoint not resumed");
+    bool relit = !rig.run(30.0, [&] { return PlantModel::litMask() == cp.ballastMask; });
+    snprintf(message, sizeof(message), "mask %u relit %.1f s after the reset", cp.ballastMask, rig.elapsed);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE_MESSAGE(relit, "checkpointed mask not relit within 30 s");
+}
+
+void test_reset_past_the_resume_window_starts_cold() {
+    resetAfterCheckpoint(45.0, CHECKPOINT_RESUME_WINDOW_S - 45.0 + 5.0);
+    TEST_ASSERT_FALSE(rig.lighting->resumedFromCheckpoint);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_boot_reports_power_loss);
+    RUN_TEST(test_checkpoint_survives_a_reset);
+    RUN_TEST(test_rtc_behind_the_checkpoint_is_overruled);
+    RUN_TEST(test_rtc_slightly_behind_the_checkpoint_is_trusted);
+    RUN_TEST(test_checkpoint_ring_spreads_wear);
+    RUN_TEST(test_reset_45s_after_a_checkpoint_resumes);
+    RUN_TEST(test_reset_past_the_resume_window_starts_cold);
+    return UNITY_END();
+}
@@ -0,0 +1,110 @@
+#include <unity.h>
+#include "ControllerRig.h"
+
+// Transition settle latency (lastDimSettleMs / lastBrightSettleMs) on the plant model, and the
+// SettleDetector itself on synthetic error signals. The rule it replaced needed 10 s inside
+// +-2% per wait.
+
+static ControllerRig rig;
+static char message[120];
+
+void setUp() {}
+void tearDown() {}
+
+// Lit from 'from' for 20 minutes, then the clock jumps to 'to': a ballast step the planner
+// did not see coming, so it runs the full WAIT_FOR_DIM -> switch -> WAIT_FOR_BRIGHT sequence
+static void ballastStep(long from, long to) {
+    rig.powerOn();
+    rig.setClock(from);
+    rig.run(1200.0);
+    uint8_t fromMask = PlantModel::litMask();
+
+    unsigned long lastStep = rig.lighting->lastStepMs;
+    rig.setClock(to);
+    bool finished = !rig.run(60.0, [&] { return rig.lighting->lastStepMs != lastStep; });
+    TEST_ASSERT_TRUE_MESSAGE(finished, "transition did not finish");
+
+    snprintf(message, sizeof(message), "mask %u -> %u: dim %lu ms, bright %lu ms, step %lu ms",
+             fromMask, PlantModel::litMask(), rig.lighting->lastDimSettleMs,
+             rig.lighting->lastBrightSettleMs, rig.lighting->lastStepMs);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_EQUAL(0, rig.lighting->settleTimeouts);
+}
+
+// 08:10 on B3 alone at 58% -> 09:15, B1+B3 at 54%
+void test_adding_a_ballast_settles_each_wait_in_2_s() {
+    ballastStep(8 * 3600L + 600, 9 * 3600L + 900);
+    TEST_ASSERT_EQUAL(BALLAST_1 | BALLAST_3, PlantModel::litMask());
+    TEST_ASSERT_UINT32_WITHIN(500, 1270, rig.lighting->lastDimSettleMs);
+    TEST_ASSERT_UINT32_WITHIN(500, 1940, rig.lighting->lastBrightSettleMs);
+}
+
+// 09:15 on B1+B3 at 82% -> 11:31:20, B3 alone: the dim wait spans a 30% drop
+void test_dropping_a_ballast_settles_each_wait_in_6_s() {
+    ballastStep(9 * 3600L + 900, 11 * 3600L + 31 * 60 + 20);
+    TEST_ASSERT_EQUAL(BALLAST_3, PlantModel::litMask());
+    TEST_ASSERT_UINT32_WITHIN(1000, 5440, rig.lighting->lastDimSettleMs);
+    TEST_ASSERT_UINT32_WITHIN(1000, 3560, rig.lighting->lastBrightSettleMs);
+}
+
+// Lights out has nothing lit to settle on: neither wait may sit out the timeout
+void test_lights_out_skips_both_waits() {
+    ballastStep(8 * 3600L + 600, 11 * 3600L + 38 * 60);
+    TEST_ASSERT_EQUAL(0, PlantModel::litMask());
+    TEST_ASSERT_EQUAL(0, rig.lighting->lastDimSettleMs);
+    TEST_ASSERT_EQUAL(0, rig.lighting->lastBrightSettleMs);
+    TEST_ASSERT_TRUE(rig.lighting->lastStepMs < SEQUENTIAL_SWITCH_DELAY_MS);
+}
+
+static const unsigned long TAU_MS = 80; // plant model time constant
+
+// Feeds 'error(t)' one sample per feedback window for up to 'seconds'; returns when the
+// detector first reports settled, or -1
+template<class Error>
+static float firstSettled(float seconds, Error error) {
+    SettleDetector detector;
+    detector.reset();
+    for (float t = 0.0f; t < seconds; t += ADC_WINDOW_MS / 1000.0f) {
+        plant.advance((unsigned long)(ADC_WINDOW_MS * 1000.0f));
+        detector.sample(error(t), TAU_MS);
+        if (detector.settled(TAU_MS)) return t;
+    }
+    return -1.0f;
+}
+
+// First-order approach from 20% off: the rate drops under SETTLE_MAX_RATE about 6 tau in
+// (filter lag included), then the detector holds off another SETTLE_TAUS tau
+void test_first_order_step_settles_in_about_a_second() {
+    float t = firstSettled(5.0f, [](float t) { return 20.0f * expf(-t * 1000.0f / TAU_MS); });
+    snprintf(message, sizeof(message), "first-order step settled at %.2f s", t);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(t > SETTLE_TAUS * TAU_MS / 1000.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, 1.1f, t);
+}
+
+// +-3% at 2 Hz passes through zero every 250 ms; the rate term must hold it off throughout
+void test_sustained_oscillation_never_settles() {
+    float t = firstSettled(20.0f, [](float t) { return 3.0f * sinf(2.0f * PI * 2.0f * t); });
+    TEST_ASSERT_TRUE(t < 0.0f);
+}
+
+// Decaying 2 Hz oscillation, envelope 10% with a 1 s time constant: the envelope is under
+// SETTLE_MAX_ERROR from 2.3 s, but the swing only slows below SETTLE_MAX_RATE later
+void test_ringing_settles_only_once_the_swing_slows() {
+    float t = firstSettled(20.0f, [](float t) { return 10.0f * expf(-t) * sinf(2.0f * PI * 2.0f * t); });
+    snprintf(message, sizeof(message), "ringing settled at %.2f s", t);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(t > logf(10.0f / SETTLE_MAX_ERROR));
+    TEST_ASSERT_TRUE(t < 10.0f);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_adding_a_ballast_settles_each_wait_in_2_s);
+    RUN_TEST(test_dropping_a_ballast_settles_each_wait_in_6_s);
+    RUN_TEST(test_lights_out_skips_both_waits);
+    RUN_TEST(test_first_order_step_settles_in_about_a_second);
+    RUN_TEST(test_sustained_oscillation_never_settles);
+    RUN_TEST(test_ringing_settles_only_once_the_swing_slows);
+    return UNITY_END();
+}
@@ -0,0 +1,120 @@
+#include <unity.h>
+#include "PlantModel.h"
+#include "OutputRegulator.h"
+#include "AdcCalibration.h"
+#include "StepResponse.h"
+
+// StepResponse rise and overshoot on step responses whose answers are known: a first-order
+// lag rises 10-90% in tau x ln 9 with no overshoot; a second-order one with damping zeta
+// overshoots by exp(-pi zeta / sqrt(1 - zeta^2)).
+
+static const float WINDOW_S = ADC_WINDOW_MS / 1000.0f;
+static char message[120];
+
+void setUp() {}
+void tearDown() {}
+
+// 'response(t)' from 0 to 1 of a 20% -> 60% step, sampled at the end of each window
+template<class Response>
+static void record(StepResponse& step, Response response) {
+    step.begin(20.0f);
+    for (uint8_t i = 1; !step.sample(20.0f + 40.0f * response(i * WINDOW_S)); i++) {}
+}
+
+void test_first_order_rise_is_tau_ln9() {
+    const float tau = 0.08f;
+    StepResponse step;
+    record(step, [&](float t) { return 1.0f - expf(-t / tau); });
+    snprintf(message, sizeof(message), "first order, tau 80 ms: rise %.1f ms, overshoot %.2f%%",
+             step.riseMs(), step.overshootPercent());
+    TEST_MESSAGE(message);
+
+    TEST_ASSERT_TRUE(step.measurable());
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 60.0f, step.settled);
+    TEST_ASSERT_FLOAT_WITHIN(5.0f, tau * logf(9.0f) * 1000.0f, step.riseMs());
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 0.0f, step.overshootPercent());
+}
+
+// zeta 0.5 at 3 Hz: 16.3% overshoot, peaking ~10 windows in and rung out by the settled mean
+void test_second_order_overshoot() {
+    const float zeta = 0.5f, wn = 2.0f * PI * 3.0f, wd = wn * sqrtf(1.0f - zeta * zeta);
+    StepResponse step;
+    record(step, [&](float t) {
+        return 1.0f - expf(-zeta * wn * t) * (cosf(wd * t) + zeta / sqrtf(1.0f - zeta * zeta) * sinf(wd * t));
+    });
+    float expected = 100.0f * expf(-PI * zeta / sqrtf(1.0f - zeta * zeta));
+    snprintf(message, sizeof(message), "second order, zeta 0.5: overshoot %.2f%% (exact %.2f%%), rise %.1f ms",
+             step.overshootPercent(), expected, step.riseMs());
+    TEST_MESSAGE(message);
+
+    // The three-window mean shaves a little off the peak
+    TEST_ASSERT_FLOAT_WITHIN(1.5f, expected, step.overshootPercent());
+    TEST_ASSERT_TRUE(step.overshootPercent() <= expected);
+}
+
+// One window 10% of the step high is noise, not ringing: a third of it survives the mean
+void test_single_noisy_window_is_not_overshoot() {
+    StepResponse step;
+    record(step, [](float t) { return t > 0.3f && t < 0.3f + WINDOW_S ? 1.1f : (t > 0.1f ? 1.0f : 0.0f); });
+    TEST_ASSERT_TRUE(step.overshootPercent() < 4.0f);
+}
+
+// A lag too slow to reach 90% within the trace reads as the whole trace, not as the part of it
+// after the 10% crossing - nor as 0 when it never reaches 10% either
+void test_unfinished_rise_reads_as_the_trace_length() {
+    StepResponse step;
+    record(step, [](float t) { return 1.0f - expf(-t / 2.0f); });
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, SELF_TEST_TRACE_WINDOWS * ADC_WINDOW_MS, step.riseMs());
+
+    record(step, [](float t) { return t < 1.0f ? 0.05f * t : 1.0f; });
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, SELF_TEST_TRACE_WINDOWS * ADC_WINDOW_MS, step.riseMs());
+}
+
+// The plant model's own lag (80 ms) from an open-loop output step, read through the real
+// feedback windows as runSelfTest() reads them
+void test_plant_step_rise() {
+    AdcCalibration cal;
+    cal.setDefaults();
+    OutputRegulator::setFeedbackScale(cal.zeroCounts, cal.fullCounts, 1.0f);
+    OutputRegulator::begin();
+    Ballast1RelayPin::low(); // relays are active-low
+    Ballast2RelayPin::high();
+    Ballast3RelayPin::high();
+
+    OutputRegulator::setOutputPercent(30.0f);
+    OutputRegulator::set(0.0f, 30.0f, true);
+    plant.run(1.0);
+
+    float feedback;
+    uint8_t window = OutputRegulator::readFeedback(feedback);
+    StepResponse step;
+    step.begin(feedback);
+    OutputRegulator::setOutputPercent(70.0f);
+    OutputRegulator::set(0.0f, 70.0f, true);
+    for (bool done = false; !done; ) {
+        plant.advance(1000);
+        uint8_t w = OutputRegulator::readFeedback(feedback);
+        if (w != window) {
+            window = w;
+            done = step.sample(feedback);
+        }
+    }
+    snprintf(message, sizeof(message), "plant, B1: %.2f%% -> %.2f%%, rise %.1f ms, overshoot %.2f%%",
+             step.start, step.settled, step.riseMs(), step.overshootPercent());
+    TEST_MESSAGE(message);
+
+    TEST_ASSERT_FLOAT_WITHIN(0.3f, plant.settledFeedback(70.0f), step.settled);
+    // Window means lag the line, but by the same at 10% and 90%: the rise is the plant's
+    TEST_ASSERT_FLOAT_WITHIN(10.0f, plant.tauMs * logf(9.0f), step.riseMs());
+    TEST_ASSERT_TRUE(step.overshootPercent() < 1.0f);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_order_rise_is_tau_ln9);
+    RUN_TEST(test_second_order_overshoot);
+    RUN_TEST(test_single_noisy_window_is_not_overshoot);
+    RUN_TEST(test_unfinished_rise_reads_as_the_trace_length);
+    RUN_TEST(test_plant_step_rise);
+    return UNITY_END();
+}